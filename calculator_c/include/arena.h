@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Арена - линейный (bump) распределитель памяти для данных одного разбора:
+ * лексического анализатора, синтаксического анализатора, идентификаторов и узлов AST.
+ * Память выделяется сдвигом указателя внутри блока и не освобождается по отдельности:
+ * все выделенное освобождается разом сбросом арены за O(1). Блоки при сбросе
+ * не возвращаются системе, а используются следующим разбором
+ * Используем неполный тип для скрытия реализации (паттерн "Непрозрачный указатель")
+ */
+typedef struct arena_t arena_t;
+
+/**
+ * Создает арену
+ * @param block_size Размер блока, которыми арена запрашивает память у системы
+ * @return Указатель на созданную арену или NULL при ошибке
+ */
+arena_t* arena_create(size_t block_size);
+
+/**
+ * Освобождает арену вместе со всеми ее блоками
+ * @param arena Указатель на арену (допускается NULL)
+ */
+void arena_destroy(arena_t* arena);
+
+/**
+ * Выделяет память в арене
+ * Память выровнена для хранения любого скалярного типа и действительна до сброса арены
+ * @param arena Указатель на арену
+ * @param size Размер в байтах
+ * @return Указатель на выделенную память или NULL при ошибке
+ */
+void* arena_alloc(arena_t* arena, size_t size);
+
+/**
+ * Копирует строку в арену
+ * @param arena Указатель на арену
+ * @param str Начало строки
+ * @param length Длина строки в байтах (без завершающего нуля)
+ * @return Указатель на копию, завершенную нулем, или NULL при ошибке
+ */
+char* arena_strndup(arena_t* arena, const char* str, size_t length);
+
+/**
+ * Освобождает всю выделенную в арене память за O(1)
+ * Указатели, полученные до сброса, становятся недействительными
+ * @param arena Указатель на арену
+ */
+void arena_reset(arena_t* arena);
+
+#endif // ARENA_H
@@ -1,6 +1,8 @@
 #ifndef AST_H
 #define AST_H
 
+#include "arena.h"
+
 /**
  * Перечисление типов узлов абстрактного синтаксического дерева
  */
@@ -8,21 +10,25 @@ typedef enum {
     AST_NUMBER,    // Числовая константа
     AST_VARIABLE,  // Переменная
     AST_UNARY_OP,  // Унарная операция (например, sin, cos, факториал)
-    AST_BINARY_OP  // Бинарная операция (+, -, *, /, ^)
+    AST_BINARY_OP, // Бинарная операция (+, -, *, /, ^)
+    AST_BINARY_FUNC // Вызов функции двух аргументов (например, mod(10, 3))
 } ast_node_type_t;
 
 /**
  * Структура узла абстрактного синтаксического дерева (AST)
- * Представляет собой универсальный узел, который может быть одним
- * из четырех типов: число, переменная, унарная операция или бинарная операция
+ * Представляет собой универсальный узел, который может быть одним из пяти типов:
+ * число, переменная, унарная операция, бинарная операция или функция двух аргументов
+ * Узлы размещаются в арене и освобождаются все сразу ее сбросом (arena_reset);
+ * строки имен не копируются: узел хранит указатель на имя, размещенное в той же
+ * арене лексическим анализатором, или на строковую константу
  */
 typedef struct ast_node_t {
     ast_node_type_t type;  // Тип узла
     union {
         double number;     // Значение, если узел - число
-        char* variable;    // Имя переменной, если узел - переменная
+        const char* variable;  // Имя переменной, если узел - переменная
         struct {
-            char* oper;    // Имя операции (например, "sin", "cos", "!")
+            const char* oper;  // Имя операции (например, "sin", "cos", "!")
             struct ast_node_t* operand;  // Операнд унарной операции
         } unary_op;
         struct {
@@ -30,44 +36,57 @@ typedef struct ast_node_t {
             struct ast_node_t* left;     // Левый операнд
             struct ast_node_t* right;    // Правый операнд
         } binary_op;
+        struct {
+            const char* name;  // Имя функции
+            struct ast_node_t* left;     // Первый аргумент
+            struct ast_node_t* right;    // Второй аргумент
+        } binary_func;
     } value;
 } ast_node_t;
 
 /**
  * Создает узел AST для числового значения
+ * @param arena Арена, в которой размещается узел
  * @param value Числовое значение
  * @return Указатель на созданный узел AST или NULL при ошибке
  */
-ast_node_t* ast_create_number(double value);
+ast_node_t* ast_create_number(arena_t* arena, double value);
 
 /**
  * Создает узел AST для переменной
- * @param name Имя переменной
+ * @param arena Арена, в которой размещается узел
+ * @param name Имя переменной (не копируется и должно жить не меньше узла)
  * @return Указатель на созданный узел AST или NULL при ошибке
  */
-ast_node_t* ast_create_variable(const char* name);
+ast_node_t* ast_create_variable(arena_t* arena, const char* name);
 
 /**
  * Создает узел AST для унарной операции
- * @param op Название операции (например, "sin", "cos", "!")
+ * @param arena Арена, в которой размещается узел
+ * @param op Название операции (например, "sin", "cos", "!"; не копируется)
  * @param operand Указатель на узел AST операнда
  * @return Указатель на созданный узел AST или NULL при ошибке
  */
-ast_node_t* ast_create_unary_op(const char* op, ast_node_t* operand);
+ast_node_t* ast_create_unary_op(arena_t* arena, const char* op, ast_node_t* operand);
 
 /**
  * Создает узел AST для бинарной операции
+ * @param arena Арена, в которой размещается узел
  * @param op Символ операции (+, -, *, /, ^)
  * @param left Указатель на узел AST левого операнда
  * @param right Указатель на узел AST правого операнда
  * @return Указатель на созданный узел AST или NULL при ошибке
  */
-ast_node_t* ast_create_binary_op(char op, ast_node_t* left, ast_node_t* right);
+ast_node_t* ast_create_binary_op(arena_t* arena, char op, ast_node_t* left, ast_node_t* right);
 
 /**
- * Освобождает память, занятую узлом AST и всеми его дочерними узлами
- * @param node Указатель на узел AST для удаления
+ * Создает узел AST для вызова функции двух аргументов
+ * @param arena Арена, в которой размещается узел
+ * @param name Имя функции (не копируется)
+ * @param left Указатель на узел AST первого аргумента
+ * @param right Указатель на узел AST второго аргумента
+ * @return Указатель на созданный узел AST или NULL при ошибке
  */
-void ast_destroy(ast_node_t* node);
+ast_node_t* ast_create_binary_func(arena_t* arena, const char* name, ast_node_t* left, ast_node_t* right);
 
 #endif // AST_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define CALCULATOR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * Коды ошибок калькулятора
@@ -27,6 +28,21 @@ typedef struct {
  */
 typedef struct calculator_ctx_t calculator_ctx_t;
 
+/**
+ * Скомпилированное выражение: результат однократного разбора строки,
+ * который можно вычислять многократно без повторного анализа
+ * Используем неполный тип для скрытия реализации (паттерн "Непрозрачный указатель")
+ */
+typedef struct calc_expr_t calc_expr_t;
+
+/**
+ * Окружение: собственный набор значений переменных, по одному на поток.
+ * Вместе с окружениями одно скомпилированное выражение вычисляется
+ * одновременно в нескольких потоках без повторного разбора
+ * Используем неполный тип для скрытия реализации (паттерн "Непрозрачный указатель")
+ */
+typedef struct calc_env_t calc_env_t;
+
 /**
  * Публичный API калькулятора
  */
@@ -61,6 +77,35 @@ calc_error_t calc_set_variable(calculator_ctx_t* ctx, const char* name, double v
  */
 calc_error_t calc_get_variable(calculator_ctx_t* ctx, const char* name, double* value);
 
+/**
+ * Возвращает номер ячейки переменной, создавая ячейку без значения, если ее еще нет
+ * Номер не меняется до уничтожения контекста; по нему значение обновляется
+ * без поиска по имени, а скомпилированные выражения читают ту же ячейку
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя переменной
+ * @param slot Указатель для записи номера ячейки
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+calc_error_t calc_bind_variable(calculator_ctx_t* ctx, const char* name, size_t* slot);
+
+/**
+ * Устанавливает значение переменной по номеру ячейки
+ * @param ctx Указатель на контекст калькулятора
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Значение переменной
+ * @return Код ошибки (CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если ячейки нет)
+ */
+calc_error_t calc_set_slot(calculator_ctx_t* ctx, size_t slot, double value);
+
+/**
+ * Получает значение переменной по номеру ячейки
+ * @param ctx Указатель на контекст калькулятора
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Указатель для записи значения переменной
+ * @return Код ошибки (CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если значение не задано)
+ */
+calc_error_t calc_get_slot(calculator_ctx_t* ctx, size_t slot, double* value);
+
 /**
  * Вычисляет математическое выражение
  * @param ctx Указатель на контекст калькулятора
@@ -70,6 +115,111 @@ calc_error_t calc_get_variable(calculator_ctx_t* ctx, const char* name, double*
  */
 calc_error_t calc_evaluate(calculator_ctx_t* ctx, const char* expression, double* result);
 
+/**
+ * Разбирает выражение один раз для последующих многократных вычислений
+ * Значения переменных не фиксируются при компиляции: они берутся из контекста
+ * при каждом вызове calc_eval_compiled
+ * @param ctx Указатель на контекст калькулятора (должен существовать, пока используется выражение)
+ * @param expression Строка с математическим выражением
+ * @return Указатель на скомпилированное выражение или NULL при синтаксической ошибке
+ */
+calc_expr_t* calc_compile(calculator_ctx_t* ctx, const char* expression);
+
+/**
+ * Вычисляет скомпилированное выражение с текущими значениями переменных контекста
+ * @param expr Указатель на скомпилированное выражение
+ * @param result Указатель для записи результата вычисления
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+calc_error_t calc_eval_compiled(const calc_expr_t* expr, double* result);
+
+/**
+ * Вычисляет скомпилированное выражение для n строк данных за один вызов
+ * Значения переменных передаются столбцами: columns[slot] - массив из n значений
+ * переменной с номером ячейки slot (см. calc_bind_variable). Массив columns должен
+ * содержать элементы для всех ячеек, которые читает выражение; переменная, для
+ * которой столбец равен NULL (или columns равен NULL), берется из контекста
+ * и одинакова для всех строк
+ * @param expr Указатель на скомпилированное выражение
+ * @param columns Столбцы значений переменных по номерам ячеек
+ * @param n Число строк
+ * @param out Массив из n элементов для записи результатов
+ * @return Код ошибки (CALC_SUCCESS при успехе); если вычисление хотя бы одной
+ *         строки завершилось ошибкой, возвращается ее код, а содержимое out не определено
+ */
+calc_error_t calc_eval_batch(const calc_expr_t* expr, const double* const* columns, size_t n, double* out);
+
+/**
+ * Окружения и многопоточное вычисление
+ *
+ * Скомпилированное выражение при вычислении не изменяется. Функции calc_eval_env и
+ * calc_eval_batch_env читают только выражение, реестр функций контекста и переданное
+ * окружение, поэтому их можно вызывать одновременно из нескольких потоков для одного
+ * выражения, если у каждого потока свое окружение. Функции, изменяющие контекст
+ * (calc_compile, calc_evaluate, calc_bind_variable, calc_set_variable, calc_set_slot,
+ * calc_register_unary_op, calc_register_binary_op), нельзя вызывать одновременно
+ * с вычислением в других потоках
+ */
+
+/**
+ * Создает окружение со значениями переменных, заданными в контексте на момент вызова
+ * @param ctx Указатель на контекст калькулятора (должен существовать, пока используется окружение)
+ * @return Указатель на окружение или NULL при ошибке
+ */
+calc_env_t* calc_env_create(const calculator_ctx_t* ctx);
+
+/**
+ * Освобождает окружение
+ * @param env Указатель на окружение (допускается NULL)
+ */
+void calc_env_destroy(calc_env_t* env);
+
+/**
+ * Устанавливает значение переменной в окружении; контекст и другие окружения не изменяются
+ * @param env Указатель на окружение
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Значение переменной
+ * @return Код ошибки (CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если ячейки нет)
+ */
+calc_error_t calc_env_set_slot(calc_env_t* env, size_t slot, double value);
+
+/**
+ * Получает значение переменной из окружения
+ * @param env Указатель на окружение
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Указатель для записи значения переменной
+ * @return Код ошибки (CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если значение не задано)
+ */
+calc_error_t calc_env_get_slot(const calc_env_t* env, size_t slot, double* value);
+
+/**
+ * Вычисляет скомпилированное выражение со значениями переменных из окружения
+ * @param expr Указатель на скомпилированное выражение
+ * @param env Окружение, созданное для контекста выражения
+ * @param result Указатель для записи результата вычисления
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+calc_error_t calc_eval_env(const calc_expr_t* expr, const calc_env_t* env, double* result);
+
+/**
+ * Вычисляет скомпилированное выражение для n строк данных, как calc_eval_batch;
+ * переменные без столбцов берутся из окружения
+ * @param expr Указатель на скомпилированное выражение
+ * @param env Окружение, созданное для контекста выражения
+ * @param columns Столбцы значений переменных по номерам ячеек
+ * @param n Число строк
+ * @param out Массив из n элементов для записи результатов
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+calc_error_t calc_eval_batch_env(const calc_expr_t* expr, const calc_env_t* env,
+                                 const double* const* columns, size_t n, double* out);
+
+/**
+ * Освобождает ресурсы, занятые скомпилированным выражением
+ * @param expr Указатель на скомпилированное выражение (допускается NULL)
+ */
+void calc_expr_free(calc_expr_t* expr);
+
 /**
  * Возвращает текстовое описание ошибки по её коду
  * @param error Код ошибки
@@ -92,20 +242,25 @@ typedef double (*unary_op_func)(double);
 typedef double (*binary_op_func)(double, double);
 
 /**
- * Регистрирует новую унарную операцию
+ * Регистрирует новую унарную операцию, вызываемую в выражении как name(x)
+ * Повторная регистрация заменяет функцию, в том числе в уже скомпилированных выражениях.
+ * Встроенные операции (-, !, sin, cos) переопределить нельзя
  * @param ctx Указатель на контекст калькулятора
  * @param name Имя операции (например, "tan" для тангенса)
  * @param func Указатель на функцию, реализующую операцию
- * @return Код ошибки (CALC_SUCCESS при успехе)
+ * @return Код ошибки (CALC_SUCCESS при успехе, CALC_ERROR_INVALID_OPERATION
+ *         для встроенной операции, CALC_ERROR_SYNTAX для имени, не являющегося идентификатором)
  */
 calc_error_t calc_register_unary_op(calculator_ctx_t* ctx, const char* name, unary_op_func func);
 
 /**
- * Регистрирует новую бинарную операцию
+ * Регистрирует новую бинарную операцию, вызываемую в выражении как name(a, b)
+ * Повторная регистрация заменяет функцию, в том числе в уже скомпилированных выражениях
  * @param ctx Указатель на контекст калькулятора
- * @param name Имя операции (символ операции)
+ * @param name Имя операции (например, "mod" для остатка от деления)
  * @param func Указатель на функцию, реализующую операцию
- * @return Код ошибки (CALC_SUCCESS при успехе)
+ * @return Код ошибки (CALC_SUCCESS при успехе, CALC_ERROR_SYNTAX
+ *         для имени, не являющегося идентификатором)
  */
 calc_error_t calc_register_binary_op(calculator_ctx_t* ctx, const char* name, binary_op_func func);
 
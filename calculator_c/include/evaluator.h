@@ -3,6 +3,7 @@
 
 #include "ast.h"
 #include "calculator.h"
+#include <stdbool.h>
 
 /**
  * Структура вычислителя выражений
@@ -24,12 +25,63 @@ evaluator_t* evaluator_create(calculator_ctx_t* calc_ctx);
 void evaluator_destroy(evaluator_t* eval);
 
 /**
- * Вычисляет значение выражения, представленного в виде абстрактного синтаксического дерева
+ * Проверяет, является ли имя встроенной унарной операцией или функцией (-, !, sin, cos)
+ * Встроенные операции вычисляются отдельными инструкциями, остальные имена
+ * вызываются через реестр функций контекста
+ * @param name Имя операции
+ * @return true для встроенной операции, иначе false
+ */
+bool evaluator_is_builtin(const char* name);
+
+/**
+ * Программа вычисления выражения: непрерывный массив инструкций стековой машины,
+ * в который компилируется AST. Константы хранятся прямо в инструкциях, переменные
+ * и зарегистрированные функции заданы номерами ячеек и записей реестра контекста,
+ * поэтому при вычислении не сравниваются строки и не обходятся узлы дерева
+ */
+typedef struct program_t program_t;
+
+/**
+ * Компилирует AST выражения в программу
+ * AST после компиляции не нужен и может быть освобожден
  * @param eval Указатель на вычислитель выражений
- * @param node Корневой узел AST выражения для вычисления
+ * @param node Корневой узел AST выражения
+ * @return Указатель на программу или NULL при ошибке
+ */
+program_t* evaluator_compile(evaluator_t* eval, const ast_node_t* node);
+
+/**
+ * Выполняет программу со значениями переменных из окружения
+ * Программа и вычислитель при выполнении не изменяются, поэтому одну программу
+ * можно выполнять одновременно в нескольких потоках с разными окружениями
+ * @param eval Указатель на вычислитель выражений, для которого скомпилирована программа
+ * @param program Указатель на программу
+ * @param env Окружение со значениями переменных; NULL - окружение контекста
  * @param result Указатель для записи результата вычисления
  * @return Код ошибки (CALC_SUCCESS при успехе)
  */
-calc_error_t evaluator_evaluate(evaluator_t* eval, ast_node_t* node, double* result);
+calc_error_t evaluator_run(const evaluator_t* eval, const program_t* program,
+                           const calc_env_t* env, double* result);
+
+/**
+ * Выполняет программу для n строк значений переменных, обрабатывая
+ * строки блоками: каждая инструкция применяется сразу к столбцу блока
+ * @param eval Указатель на вычислитель выражений, для которого скомпилирована программа
+ * @param program Указатель на программу
+ * @param env Окружение со значениями переменных без столбцов; NULL - окружение контекста
+ * @param columns Столбцы значений по номерам ячеек переменных; NULL вместо столбца
+ *                (или вместо всего массива) - значение переменной берется из окружения
+ * @param n Число строк
+ * @param out Массив из n элементов для записи результатов
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+calc_error_t evaluator_run_batch(const evaluator_t* eval, const program_t* program, const calc_env_t* env,
+                                 const double* const* columns, size_t n, double* out);
+
+/**
+ * Освобождает ресурсы, занятые программой
+ * @param program Указатель на программу (допускается NULL)
+ */
+void program_destroy(program_t* program);
 
 #endif // EVALUATOR_H
\ No newline at end of file
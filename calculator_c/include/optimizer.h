@@ -0,0 +1,22 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ast.h"
+#include "evaluator.h"
+
+/**
+ * Оптимизирует AST перед компиляцией в программу:
+ * - сворачивает константные поддеревья (включая PI и факториал литерала);
+ * - упрощает x*1, 1*x, x+0, 0+x, x-0, x/1 и x^1 до x;
+ * - заменяет целую степень переменной x^n (2 <= n <= 8) цепочкой умножений.
+ * Поддерево, вычисление которого завершается ошибкой (например, 1/0 или (-1)!),
+ * не сворачивается, поэтому ошибка по-прежнему сообщается при вычислении
+ * и в том же порядке.
+ * @param eval Указатель на вычислитель выражений, которым вычисляются константы
+ * @param arena Арена, в которой размещено дерево; в ней же создаются новые узлы
+ * @param node Корневой узел AST; узлы дерева могут быть заменены
+ * @return Корневой узел оптимизированного AST
+ */
+ast_node_t* optimizer_optimize(evaluator_t* eval, arena_t* arena, ast_node_t* node);
+
+#endif // OPTIMIZER_H
@@ -12,16 +12,12 @@ typedef struct parser_t parser_t;
 
 /**
  * Создает новый синтаксический анализатор
+ * Анализатор и узлы AST размещаются в арене и освобождаются ее сбросом
+ * @param arena Арена для анализатора и узлов AST
  * @param lexer Указатель на лексический анализатор, который будет использоваться для получения лексем
  * @return Указатель на созданный синтаксический анализатор или NULL при ошибке
  */
-parser_t* parser_create(lexer_t* lexer);
-
-/**
- * Освобождает ресурсы, занятые синтаксическим анализатором
- * @param parser Указатель на синтаксический анализатор
- */
-void parser_destroy(parser_t* parser);
+parser_t* parser_create(arena_t* arena, lexer_t* lexer);
 
 /**
  * Разбирает выражение и строит абстрактное синтаксическое дерево
@@ -0,0 +1,120 @@
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Выравнивание выделяемой памяти: достаточно для double, указателей и size_t
+#define ARENA_ALIGNMENT 16
+
+/**
+ * Блок памяти арены. Блоки образуют список; после сброса арены
+ * они заполняются заново в том же порядке.
+ */
+typedef struct arena_block_t {
+    struct arena_block_t* next;  // Следующий блок списка
+    size_t size;                 // Размер области данных
+    size_t used;                 // Занято байт области данных
+    unsigned char data[];        // Область данных
+} arena_block_t;
+
+struct arena_t {
+    arena_block_t* first;    // Первый блок списка
+    arena_block_t* current;  // Блок, из которого сейчас выделяется память
+    size_t block_size;       // Размер новых блоков
+};
+
+/**
+ * Создает блок с областью данных заданного размера.
+ *
+ * @param size Размер области данных
+ * @return Указатель на блок или NULL при ошибке
+ */
+static arena_block_t* block_create(size_t size) {
+    arena_block_t* block = malloc(sizeof(arena_block_t) + size);
+    if (block) {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+    }
+    return block;
+}
+
+/**
+ * Выделяет память в блоке, если она в нем помещается.
+ *
+ * @param block Блок арены
+ * @param size Размер в байтах
+ * @return Указатель на выделенную память или NULL, если места не хватает
+ */
+static void* block_alloc(arena_block_t* block, size_t size) {
+    uintptr_t base = (uintptr_t)block->data;
+    uintptr_t start = (base + block->used + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1);
+    if (start - base > block->size || size > block->size - (start - base)) {
+        return NULL;
+    }
+    block->used = start - base + size;
+    return (void*)start;
+}
+
+arena_t* arena_create(size_t block_size) {
+    arena_t* arena = malloc(sizeof(arena_t));
+    if (arena) {
+        arena->block_size = block_size;
+        arena->first = block_create(block_size);
+        arena->current = arena->first;
+        if (!arena->first) {
+            free(arena);
+            return NULL;
+        }
+    }
+    return arena;
+}
+
+void arena_destroy(arena_t* arena) {
+    if (arena) {
+        arena_block_t* block = arena->first;
+        while (block) {
+            arena_block_t* next = block->next;
+            free(block);
+            block = next;
+        }
+        free(arena);
+    }
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+    if (!arena) return NULL;
+
+    for (;;) {
+        void* memory = block_alloc(arena->current, size);
+        if (memory) return memory;
+
+        // Переходим к блоку, оставшемуся от прошлых разборов, или добавляем новый
+        arena_block_t* next = arena->current->next;
+        if (!next) {
+            size_t data_size = size + ARENA_ALIGNMENT > arena->block_size ? size + ARENA_ALIGNMENT
+                                                                          : arena->block_size;
+            next = block_create(data_size);
+            if (!next) return NULL;
+            arena->current->next = next;
+        }
+        next->used = 0;
+        arena->current = next;
+    }
+}
+
+char* arena_strndup(arena_t* arena, const char* str, size_t length) {
+    char* copy = arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, str, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+void arena_reset(arena_t* arena) {
+    if (arena) {
+        arena->current = arena->first;
+        arena->first->used = 0;
+    }
+}
@@ -1,14 +1,13 @@
 #include "ast.h"
-#include <stdlib.h>
-#include <string.h>
 
 /**
  * Создает узел AST для числового значения
+ * @param arena Арена, в которой размещается узел
  * @param value Числовое значение
  * @return Указатель на созданный узел AST или NULL при ошибке выделения памяти
  */
-ast_node_t* ast_create_number(double value) {
-    ast_node_t* node = malloc(sizeof(ast_node_t));
+ast_node_t* ast_create_number(arena_t* arena, double value) {
+    ast_node_t* node = arena_alloc(arena, sizeof(ast_node_t));
     if (node) {
         node->type = AST_NUMBER;
         node->value.number = value;
@@ -18,31 +17,32 @@ ast_node_t* ast_create_number(double value) {
 
 /**
  * Создает узел AST для переменной
+ * @param arena Арена, в которой размещается узел
  * @param name Имя переменной
  * @return Указатель на созданный узел AST или NULL при ошибке выделения памяти
  */
-ast_node_t* ast_create_variable(const char* name) {
-    ast_node_t* node = malloc(sizeof(ast_node_t));
+ast_node_t* ast_create_variable(arena_t* arena, const char* name) {
+    ast_node_t* node = arena_alloc(arena, sizeof(ast_node_t));
     if (node) {
         node->type = AST_VARIABLE;
-        // Создаем копию строки с именем переменной
-        node->value.variable = strdup(name);
+        // Имя уже размещено в арене лексическим анализатором, копия не нужна
+        node->value.variable = name;
     }
     return node;
 }
 
 /**
  * Создает узел AST для унарной операции
+ * @param arena Арена, в которой размещается узел
  * @param op Название операции (например, "sin", "cos", "!")
  * @param operand Указатель на узел AST операнда
  * @return Указатель на созданный узел AST или NULL при ошибке выделения памяти
  */
-ast_node_t* ast_create_unary_op(const char* op, ast_node_t* operand) {
-    ast_node_t* node = malloc(sizeof(ast_node_t));
+ast_node_t* ast_create_unary_op(arena_t* arena, const char* op, ast_node_t* operand) {
+    ast_node_t* node = arena_alloc(arena, sizeof(ast_node_t));
     if (node) {
         node->type = AST_UNARY_OP;
-        // Создаем копию строки с именем оператора
-        node->value.unary_op.oper = strdup(op);
+        node->value.unary_op.oper = op;
         node->value.unary_op.operand = operand;
     }
     return node;
@@ -50,13 +50,14 @@ ast_node_t* ast_create_unary_op(const char* op, ast_node_t* operand) {
 
 /**
  * Создает узел AST для бинарной операции
+ * @param arena Арена, в которой размещается узел
  * @param op Символ операции (+, -, *, /, ^)
  * @param left Указатель на узел AST левого операнда
  * @param right Указатель на узел AST правого операнда
  * @return Указатель на созданный узел AST или NULL при ошибке выделения памяти
  */
-ast_node_t* ast_create_binary_op(char op, ast_node_t* left, ast_node_t* right) {
-    ast_node_t* node = malloc(sizeof(ast_node_t));
+ast_node_t* ast_create_binary_op(arena_t* arena, char op, ast_node_t* left, ast_node_t* right) {
+    ast_node_t* node = arena_alloc(arena, sizeof(ast_node_t));
     if (node) {
         node->type = AST_BINARY_OP;
         node->value.binary_op.oper = op;
@@ -67,34 +68,20 @@ ast_node_t* ast_create_binary_op(char op, ast_node_t* left, ast_node_t* right) {
 }
 
 /**
- * Освобождает память, занятую узлом AST и всеми его дочерними узлами
- * Рекурсивно обходит дерево и освобождает память для всех узлов
- * @param node Указатель на узел AST для удаления
+ * Создает узел AST для вызова функции двух аргументов
+ * @param arena Арена, в которой размещается узел
+ * @param name Имя функции
+ * @param left Указатель на узел AST первого аргумента
+ * @param right Указатель на узел AST второго аргумента
+ * @return Указатель на созданный узел AST или NULL при ошибке выделения памяти
  */
-void ast_destroy(ast_node_t* node) {
-    if (!node) return;
-    
-    // Обрабатываем различные типы узлов
-    switch (node->type) {
-        case AST_VARIABLE:
-            // Освобождаем память строки с именем переменной
-            free(node->value.variable);
-            break;
-        case AST_UNARY_OP:
-            // Освобождаем память строки с именем операции и рекурсивно удаляем операнд
-            free(node->value.unary_op.oper);
-            ast_destroy(node->value.unary_op.operand);
-            break;
-        case AST_BINARY_OP:
-            // Рекурсивно удаляем левый и правый операнды
-            ast_destroy(node->value.binary_op.left);
-            ast_destroy(node->value.binary_op.right);
-            break;
-        default:
-            // Для числовых узлов дополнительной очистки не требуется
-            break;
+ast_node_t* ast_create_binary_func(arena_t* arena, const char* name, ast_node_t* left, ast_node_t* right) {
+    ast_node_t* node = arena_alloc(arena, sizeof(ast_node_t));
+    if (node) {
+        node->type = AST_BINARY_FUNC;
+        node->value.binary_func.name = name;
+        node->value.binary_func.left = left;
+        node->value.binary_func.right = right;
     }
-    
-    // Освобождаем память самого узла
-    free(node);
-}
\ No newline at end of file
+    return node;
+}
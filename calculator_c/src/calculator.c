@@ -1,17 +1,16 @@
-#include "calculator.h"
+#include "calculator_internal.h"
 #include "lexer.h"
 #include "parser.h"
-#include "evaluator.h"
+#include "optimizer.h"
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_VARIABLES 100
+// Начальное число корзин хеш-таблицы переменных (степень двойки)
+#define INITIAL_BUCKETS 16
 
-struct calculator_ctx_t {
-    calc_variable_t variables[MAX_VARIABLES];
-    size_t num_variables;
-    evaluator_t* evaluator;
-};
+// Размер блока арены разбора: его хватает на выражение из сотни с лишним узлов
+#define ARENA_BLOCK_SIZE 8192
 
 /**
  * Создает контекст калькулятора.
@@ -21,9 +20,23 @@ struct calculator_ctx_t {
 calculator_ctx_t* calc_create(void) {
     calculator_ctx_t* ctx = malloc(sizeof(calculator_ctx_t));
     if (ctx) {
+        ctx->variables = NULL;
         ctx->num_variables = 0;
+        ctx->capacity = 0;
+        ctx->env.ctx = ctx;
+        ctx->env.values = NULL;
+        ctx->env.num_values = 0;
+        ctx->num_buckets = INITIAL_BUCKETS;
+        ctx->functions = NULL;
+        ctx->num_functions = 0;
+        ctx->functions_capacity = 0;
+        ctx->buckets = calloc(ctx->num_buckets, sizeof(size_t));
+        ctx->arena = arena_create(ARENA_BLOCK_SIZE);
         ctx->evaluator = evaluator_create(ctx);
-        if (!ctx->evaluator) {
+        if (!ctx->buckets || !ctx->arena || !ctx->evaluator) {
+            free(ctx->buckets);
+            arena_destroy(ctx->arena);
+            evaluator_destroy(ctx->evaluator);
             free(ctx);
             return NULL;
         }
@@ -33,7 +46,7 @@ calculator_ctx_t* calc_create(void) {
 
 /**
  * Освобождает ресурсы, занятые контекстом калькулятора.
- * Освобождает память, выделенную для имен переменных и оценщика выражений.
+ * Освобождает память, выделенную для переменных, функций, арены разбора и оценщика выражений.
  * @param ctx Указатель на контекст калькулятора
  */
 void calc_destroy(calculator_ctx_t* ctx) {
@@ -41,48 +54,270 @@ void calc_destroy(calculator_ctx_t* ctx) {
         for (size_t i = 0; i < ctx->num_variables; i++) {
             free(ctx->variables[i].name);
         }
+        free(ctx->variables);
+        free(ctx->env.values);
+        free(ctx->buckets);
+        for (size_t i = 0; i < ctx->num_functions; i++) {
+            free(ctx->functions[i].name);
+        }
+        free(ctx->functions);
+        arena_destroy(ctx->arena);
         evaluator_destroy(ctx->evaluator);
         free(ctx);
     }
 }
 
 /**
- * Устанавливает значение переменной в контексте калькулятора.
- * Если переменная уже существует, обновляет ее значение.
- * Если переменная новая, добавляет ее в список переменных.
+ * Вычисляет хеш имени переменной (FNV-1a).
+ * 
+ * @param name Имя переменной
+ * @return Хеш имени
+ */
+static size_t hash_name(const char* name) {
+    size_t hash = (size_t)2166136261u;
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++) {
+        hash = (hash ^ *c) * (size_t)16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Ищет корзину для имени: корзину с его ячейкой или первую пустую корзину.
  * 
  * @param ctx Указатель на контекст калькулятора
  * @param name Имя переменной
- * @param value Значение переменной
+ * @param hash Хеш имени
+ * @return Номер корзины
+ */
+static size_t find_bucket(const calculator_ctx_t* ctx, const char* name, size_t hash) {
+    size_t mask = ctx->num_buckets - 1;
+    size_t bucket = hash & mask;
+    while (ctx->buckets[bucket] != 0) {
+        const calc_slot_t* slot = &ctx->variables[ctx->buckets[bucket] - 1];
+        if (slot->hash == hash && strcmp(slot->name, name) == 0) {
+            break;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+/**
+ * Расширяет хеш-таблицу вдвое и заново раскладывает ячейки по корзинам.
+ * 
+ * @param ctx Указатель на контекст калькулятора
  * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
  */
-calc_error_t calc_set_variable(calculator_ctx_t* ctx, const char* name, double value) {
-    if (!ctx || !name) return CALC_ERROR_SYNTAX;
+static calc_error_t grow_buckets(calculator_ctx_t* ctx) {
+    size_t num_buckets = ctx->num_buckets * 2;
+    size_t* buckets = calloc(num_buckets, sizeof(size_t));
+    if (!buckets) return CALC_ERROR_SYNTAX;
     
-    // Проверяем, существует ли уже переменная
+    size_t mask = num_buckets - 1;
     for (size_t i = 0; i < ctx->num_variables; i++) {
-        if (strcmp(ctx->variables[i].name, name) == 0) {
-            ctx->variables[i].value = value;
-            return CALC_SUCCESS;
+        size_t bucket = ctx->variables[i].hash & mask;
+        while (buckets[bucket] != 0) {
+            bucket = (bucket + 1) & mask;
+        }
+        buckets[bucket] = i + 1;
+    }
+    
+    free(ctx->buckets);
+    ctx->buckets = buckets;
+    ctx->num_buckets = num_buckets;
+    return CALC_SUCCESS;
+}
+
+/**
+ * Возвращает номер ячейки переменной.
+ * Если переменной с таким именем нет, создает для нее ячейку без значения:
+ * значение может быть присвоено позже, уже после компиляции выражения.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя переменной
+ * @param slot Указатель, куда будет записан номер ячейки
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_bind_variable(calculator_ctx_t* ctx, const char* name, size_t* slot) {
+    if (!ctx || !name || !slot) return CALC_ERROR_SYNTAX;
+    
+    size_t hash = hash_name(name);
+    size_t bucket = find_bucket(ctx, name, hash);
+    if (ctx->buckets[bucket] != 0) {
+        *slot = ctx->buckets[bucket] - 1;
+        return CALC_SUCCESS;
+    }
+    
+    // Поддерживаем заполнение таблицы не больше половины
+    if ((ctx->num_variables + 1) * 2 > ctx->num_buckets) {
+        calc_error_t error = grow_buckets(ctx);
+        if (error != CALC_SUCCESS) return error;
+        bucket = find_bucket(ctx, name, hash);
+    }
+    
+    // Добавляем новую ячейку, при необходимости расширяя массивы ячеек и значений
+    if (ctx->num_variables == ctx->capacity) {
+        size_t capacity = ctx->capacity ? ctx->capacity * 2 : INITIAL_BUCKETS / 2;
+        calc_slot_t* variables = realloc(ctx->variables, capacity * sizeof(calc_slot_t));
+        if (!variables) return CALC_ERROR_SYNTAX;
+        ctx->variables = variables;
+        calc_value_t* values = realloc(ctx->env.values, capacity * sizeof(calc_value_t));
+        if (!values) return CALC_ERROR_SYNTAX;
+        ctx->env.values = values;
+        ctx->capacity = capacity;
+    }
+    
+    char* copy = strdup(name);
+    if (!copy) return CALC_ERROR_SYNTAX;
+    
+    calc_slot_t* variable = &ctx->variables[ctx->num_variables];
+    variable->name = copy;
+    variable->hash = hash;
+    ctx->env.values[ctx->num_variables].value = 0;
+    ctx->env.values[ctx->num_variables].defined = false;
+    ctx->env.num_values = ctx->num_variables + 1;
+    *slot = ctx->num_variables++;
+    ctx->buckets[bucket] = ctx->num_variables;
+    
+    return CALC_SUCCESS;
+}
+
+/**
+ * Устанавливает значение переменной по номеру ячейки.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Значение переменной
+ * @return Код ошибки: CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если ячейки нет
+ */
+calc_error_t calc_set_slot(calculator_ctx_t* ctx, size_t slot, double value) {
+    if (!ctx) return CALC_ERROR_SYNTAX;
+    
+    return calc_env_set_slot(&ctx->env, slot, value);
+}
+
+/**
+ * Получает значение переменной по номеру ячейки.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Указатель, куда будет записано значение переменной
+ * @return Код ошибки: CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если значение не задано
+ */
+calc_error_t calc_get_slot(calculator_ctx_t* ctx, size_t slot, double* value) {
+    if (!ctx) return CALC_ERROR_SYNTAX;
+    
+    return calc_env_get_slot(&ctx->env, slot, value);
+}
+
+/**
+ * Создает окружение - копию значений переменных контекста.
+ * При вычислении окружение только читается, поэтому у каждого потока
+ * достаточно одного окружения на все выражения контекста.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @return Указатель на окружение или NULL при ошибке
+ */
+calc_env_t* calc_env_create(const calculator_ctx_t* ctx) {
+    if (!ctx) return NULL;
+    
+    calc_env_t* env = malloc(sizeof(calc_env_t));
+    if (!env) return NULL;
+    env->ctx = ctx;
+    env->num_values = ctx->env.num_values;
+    env->values = NULL;
+    if (env->num_values > 0) {
+        env->values = malloc(env->num_values * sizeof(calc_value_t));
+        if (!env->values) {
+            free(env);
+            return NULL;
         }
+        memcpy(env->values, ctx->env.values, env->num_values * sizeof(calc_value_t));
     }
+    return env;
+}
+
+/**
+ * Освобождает окружение.
+ * 
+ * @param env Указатель на окружение
+ */
+void calc_env_destroy(calc_env_t* env) {
+    if (env) {
+        free(env->values);
+        free(env);
+    }
+}
+
+/**
+ * Устанавливает значение переменной в окружении.
+ * Окружение, созданное раньше ячейки, удлиняется до нее; пропущенные ячейки
+ * остаются без значения.
+ * 
+ * @param env Указатель на окружение
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Значение переменной
+ * @return Код ошибки: CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если ячейки нет
+ */
+calc_error_t calc_env_set_slot(calc_env_t* env, size_t slot, double value) {
+    if (!env) return CALC_ERROR_SYNTAX;
+    if (slot >= env->ctx->num_variables) return CALC_ERROR_UNDEFINED_VAR;
     
-    // Добавляем новую переменную
-    if (ctx->num_variables >= MAX_VARIABLES) {
-        return CALC_ERROR_SYNTAX;
+    if (slot >= env->num_values) {
+        size_t num_values = env->ctx->num_variables;
+        calc_value_t* values = realloc(env->values, num_values * sizeof(calc_value_t));
+        if (!values) return CALC_ERROR_SYNTAX;
+        for (size_t i = env->num_values; i < num_values; i++) {
+            values[i].value = 0;
+            values[i].defined = false;
+        }
+        env->values = values;
+        env->num_values = num_values;
     }
     
-    ctx->variables[ctx->num_variables].name = strdup(name);
-    ctx->variables[ctx->num_variables].value = value;
-    ctx->num_variables++;
+    env->values[slot].value = value;
+    env->values[slot].defined = true;
+    return CALC_SUCCESS;
+}
+
+/**
+ * Получает значение переменной из окружения.
+ * 
+ * @param env Указатель на окружение
+ * @param slot Номер ячейки, полученный от calc_bind_variable
+ * @param value Указатель, куда будет записано значение переменной
+ * @return Код ошибки: CALC_SUCCESS при успехе, CALC_ERROR_UNDEFINED_VAR если значение не задано
+ */
+calc_error_t calc_env_get_slot(const calc_env_t* env, size_t slot, double* value) {
+    if (!env || !value) return CALC_ERROR_SYNTAX;
+    if (slot >= env->num_values || !env->values[slot].defined) return CALC_ERROR_UNDEFINED_VAR;
     
+    *value = env->values[slot].value;
     return CALC_SUCCESS;
 }
 
+/**
+ * Устанавливает значение переменной в контексте калькулятора.
+ * Если переменная уже существует, обновляет ее значение.
+ * Если переменная новая, добавляет ее в таблицу переменных.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя переменной
+ * @param value Значение переменной
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_set_variable(calculator_ctx_t* ctx, const char* name, double value) {
+    size_t slot;
+    calc_error_t error = calc_bind_variable(ctx, name, &slot);
+    if (error != CALC_SUCCESS) return error;
+    
+    return calc_set_slot(ctx, slot, value);
+}
+
 /**
  * Получает значение переменной из контекста калькулятора.
- * Ищет переменную по имени и, если найдена, записывает ее значение
- * в указанное место.
+ * Ищет переменную по имени в хеш-таблице и, если она найдена и ей присвоено
+ * значение, записывает его в указанное место. Новая ячейка при этом не создается.
  * 
  * @param ctx Указатель на контекст калькулятора
  * @param name Имя переменной
@@ -92,54 +327,172 @@ calc_error_t calc_set_variable(calculator_ctx_t* ctx, const char* name, double v
 calc_error_t calc_get_variable(calculator_ctx_t* ctx, const char* name, double* value) {
     if (!ctx || !name || !value) return CALC_ERROR_SYNTAX;
     
-    for (size_t i = 0; i < ctx->num_variables; i++) {
-        if (strcmp(ctx->variables[i].name, name) == 0) {
-            *value = ctx->variables[i].value;
-            return CALC_SUCCESS;
-        }
+    size_t bucket = find_bucket(ctx, name, hash_name(name));
+    if (ctx->buckets[bucket] == 0) return CALC_ERROR_UNDEFINED_VAR;
+    
+    return calc_get_slot(ctx, ctx->buckets[bucket] - 1, value);
+}
+
+/**
+ * Скомпилированное выражение: программа стековой машины,
+ * построенная по АСД, и контекст, из ячеек которого она читает переменные
+ */
+struct calc_expr_t {
+    calculator_ctx_t* ctx;
+    program_t* program;
+};
+
+/**
+ * Разбирает выражение и переводит его в программу.
+ * Анализаторы, идентификаторы и узлы АСД размещаются в арене контекста,
+ * которая сбрасывается сразу после перевода АСД в программу, поэтому разбор
+ * не обращается к системному распределителю памяти, пока хватает блоков арены.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param expression Строка с выражением
+ * @return Указатель на программу или NULL при ошибке
+ */
+static program_t* compile_program(calculator_ctx_t* ctx, const char* expression) {
+    program_t* program = NULL;
+    
+    // Создаем лексический и синтаксический анализаторы
+    lexer_t* lexer = lexer_create(ctx->arena, expression);
+    parser_t* parser = lexer ? parser_create(ctx->arena, lexer) : NULL;
+    
+    // Разбираем выражение в АСД (абстрактное синтаксическое дерево)
+    ast_node_t* ast = parser ? parser_parse(parser) : NULL;
+    if (ast) {
+        // Сворачиваем константы и упрощаем АСД до перевода в программу
+        ast = optimizer_optimize(ctx->evaluator, ctx->arena, ast);
+        
+        // Переводим АСД в программу; имена переменных разрешаются в номера ячеек
+        program = evaluator_compile(ctx->evaluator, ast);
     }
     
-    return CALC_ERROR_UNDEFINED_VAR;
+    // АСД и анализаторы больше не нужны: освобождаем их сбросом арены
+    arena_reset(ctx->arena);
+    return program;
 }
 
 /**
- * Вычисляет значение выражения.
- * Выполняет лексический анализ, синтаксический разбор и вычисление выражения.
+ * Компилирует выражение.
+ * Выполняет лексический анализ и синтаксический разбор один раз, оптимизирует
+ * АСД и переводит его в программу; в выражении остается только программа.
  * 
  * @param ctx Указатель на контекст калькулятора
- * @param expression Строка с выражением для вычисления
+ * @param expression Строка с выражением для компиляции
+ * @return Указатель на скомпилированное выражение или NULL при ошибке
+ */
+calc_expr_t* calc_compile(calculator_ctx_t* ctx, const char* expression) {
+    if (!ctx || !expression) return NULL;
+    
+    program_t* program = compile_program(ctx, expression);
+    if (!program) return NULL;
+    
+    calc_expr_t* expr = malloc(sizeof(calc_expr_t));
+    if (!expr) {
+        program_destroy(program);
+        return NULL;
+    }
+    expr->ctx = ctx;
+    expr->program = program;
+    return expr;
+}
+
+/**
+ * Вычисляет скомпилированное выражение.
+ * Разбор не повторяется: оценщик контекста выполняет сохраненную программу.
+ * 
+ * @param expr Указатель на скомпилированное выражение
  * @param result Указатель, куда будет записан результат вычисления
  * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
  */
-calc_error_t calc_evaluate(calculator_ctx_t* ctx, const char* expression, double* result) {
-    if (!ctx || !expression || !result) return CALC_ERROR_SYNTAX;
+calc_error_t calc_eval_compiled(const calc_expr_t* expr, double* result) {
+    if (!expr || !result) return CALC_ERROR_SYNTAX;
+    
+    return evaluator_run(expr->ctx->evaluator, expr->program, NULL, result);
+}
+
+/**
+ * Вычисляет скомпилированное выражение для n строк данных.
+ * Строки обрабатываются блоками, и каждая инструкция программы применяется
+ * к целому столбцу блока, а не к одному значению.
+ * 
+ * @param expr Указатель на скомпилированное выражение
+ * @param columns Столбцы значений переменных по номерам ячеек
+ * @param n Число строк
+ * @param out Массив, куда будут записаны n результатов
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_eval_batch(const calc_expr_t* expr, const double* const* columns, size_t n, double* out) {
+    if (!expr) return CALC_ERROR_SYNTAX;
     
-    // Создаем лексический анализатор
-    lexer_t* lexer = lexer_create(expression);
-    if (!lexer) return CALC_ERROR_SYNTAX;
+    return evaluator_run_batch(expr->ctx->evaluator, expr->program, NULL, columns, n, out);
+}
+
+/**
+ * Вычисляет скомпилированное выражение в окружении.
+ * Ни выражение, ни контекст не изменяются, поэтому вызовы из разных потоков
+ * с разными окружениями не требуют синхронизации.
+ * 
+ * @param expr Указатель на скомпилированное выражение
+ * @param env Окружение контекста выражения
+ * @param result Указатель, куда будет записан результат вычисления
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_eval_env(const calc_expr_t* expr, const calc_env_t* env, double* result) {
+    if (!expr || !env || !result || env->ctx != expr->ctx) return CALC_ERROR_SYNTAX;
     
-    // Создаем синтаксический анализатор
-    parser_t* parser = parser_create(lexer);
-    if (!parser) {
-        lexer_destroy(lexer);
-        return CALC_ERROR_SYNTAX;
-    }
+    return evaluator_run(expr->ctx->evaluator, expr->program, env, result);
+}
+
+/**
+ * Вычисляет скомпилированное выражение в окружении для n строк данных.
+ * 
+ * @param expr Указатель на скомпилированное выражение
+ * @param env Окружение контекста выражения
+ * @param columns Столбцы значений переменных по номерам ячеек
+ * @param n Число строк
+ * @param out Массив, куда будут записаны n результатов
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_eval_batch_env(const calc_expr_t* expr, const calc_env_t* env,
+                                 const double* const* columns, size_t n, double* out) {
+    if (!expr || !env || env->ctx != expr->ctx) return CALC_ERROR_SYNTAX;
     
-    // Разбираем выражение в АСД (абстрактное синтаксическое дерево)
-    ast_node_t* ast = parser_parse(parser);
-    if (!ast) {
-        parser_destroy(parser);
-        lexer_destroy(lexer);
-        return CALC_ERROR_SYNTAX;
+    return evaluator_run_batch(expr->ctx->evaluator, expr->program, env, columns, n, out);
+}
+
+/**
+ * Освобождает скомпилированное выражение вместе с его программой.
+ * 
+ * @param expr Указатель на скомпилированное выражение
+ */
+void calc_expr_free(calc_expr_t* expr) {
+    if (expr) {
+        program_destroy(expr->program);
+        free(expr);
     }
+}
+
+/**
+ * Вычисляет значение выражения.
+ * Компилирует выражение, вычисляет его и сразу освобождает программу; для
+ * многократного вычисления одного выражения используйте calc_compile.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param expression Строка с выражением для вычисления
+ * @param result Указатель, куда будет записан результат вычисления
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_evaluate(calculator_ctx_t* ctx, const char* expression, double* result) {
+    if (!ctx || !expression || !result) return CALC_ERROR_SYNTAX;
     
-    // Вычисляем выражение с помощью оценщика
-    calc_error_t error = evaluator_evaluate(ctx->evaluator, ast, result);
+    program_t* program = compile_program(ctx, expression);
+    if (!program) return CALC_ERROR_SYNTAX;
     
-    // Освобождаем ресурсы
-    ast_destroy(ast);
-    parser_destroy(parser);
-    lexer_destroy(lexer);
+    calc_error_t error = evaluator_run(ctx->evaluator, program, NULL, result);
+    program_destroy(program);
     
     return error;
 }
@@ -158,4 +511,107 @@ const char* calc_get_error_message(calc_error_t error) {
         case CALC_ERROR_INVALID_OPERATION: return "Недопустимая операция";
         default: return "Неизвестная ошибка";
     }
+}
+
+/**
+ * Возвращает номер записи о функции.
+ * Функций в контексте немного, а поиск выполняется только при компиляции,
+ * поэтому записи просматриваются последовательно.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя функции
+ * @param index Указатель, куда будет записан номер записи
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_bind_function(calculator_ctx_t* ctx, const char* name, size_t* index) {
+    if (!ctx || !name || !index) return CALC_ERROR_SYNTAX;
+    
+    for (size_t i = 0; i < ctx->num_functions; i++) {
+        if (strcmp(ctx->functions[i].name, name) == 0) {
+            *index = i;
+            return CALC_SUCCESS;
+        }
+    }
+    
+    if (ctx->num_functions == ctx->functions_capacity) {
+        size_t capacity = ctx->functions_capacity ? ctx->functions_capacity * 2 : 8;
+        calc_function_t* functions = realloc(ctx->functions, capacity * sizeof(calc_function_t));
+        if (!functions) return CALC_ERROR_SYNTAX;
+        ctx->functions = functions;
+        ctx->functions_capacity = capacity;
+    }
+    
+    char* copy = strdup(name);
+    if (!copy) return CALC_ERROR_SYNTAX;
+    
+    calc_function_t* function = &ctx->functions[ctx->num_functions];
+    function->name = copy;
+    function->unary = NULL;
+    function->binary = NULL;
+    *index = ctx->num_functions++;
+    
+    return CALC_SUCCESS;
+}
+
+/**
+ * Проверяет, может ли имя быть именем функции в выражении:
+ * оно должно быть идентификатором и не совпадать со встроенной операцией.
+ * 
+ * @param name Имя функции
+ * @return Код ошибки: CALC_SUCCESS если имя допустимо, иначе код ошибки
+ */
+static calc_error_t check_function_name(const char* name) {
+    if (!name) return CALC_ERROR_SYNTAX;
+    
+    // Встроенные операции вычисляются отдельными инструкциями и не переопределяются
+    if (evaluator_is_builtin(name)) return CALC_ERROR_INVALID_OPERATION;
+    
+    if (!(isalpha((unsigned char)name[0]) || name[0] == '_')) return CALC_ERROR_SYNTAX;
+    for (const char* c = name; *c; c++) {
+        if (!isalnum((unsigned char)*c) && *c != '_') return CALC_ERROR_SYNTAX;
+    }
+    return CALC_SUCCESS;
+}
+
+/**
+ * Регистрирует унарную операцию (функцию одного аргумента).
+ * Повторная регистрация имени заменяет функцию, в том числе в уже
+ * скомпилированных выражениях: они вызывают функцию по номеру записи.
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя функции
+ * @param func Указатель на функцию
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_register_unary_op(calculator_ctx_t* ctx, const char* name, unary_op_func func) {
+    if (!ctx || !func) return CALC_ERROR_SYNTAX;
+    
+    calc_error_t error = check_function_name(name);
+    size_t index;
+    if (error == CALC_SUCCESS) error = calc_bind_function(ctx, name, &index);
+    if (error != CALC_SUCCESS) return error;
+    
+    ctx->functions[index].unary = func;
+    return CALC_SUCCESS;
+}
+
+/**
+ * Регистрирует бинарную операцию (функцию двух аргументов).
+ * В выражении она вызывается как name(a, b).
+ * 
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя функции
+ * @param func Указатель на функцию
+ * @return Код ошибки: CALC_SUCCESS при успехе, иначе код ошибки
+ */
+calc_error_t calc_register_binary_op(calculator_ctx_t* ctx, const char* name, binary_op_func func) {
+    if (!ctx || !func) return CALC_ERROR_SYNTAX;
+    
+    calc_error_t error = check_function_name(name);
+    size_t index;
+    if (error == CALC_SUCCESS) error = calc_bind_function(ctx, name, &index);
+    if (error != CALC_SUCCESS) return error;
+    
+    ctx->functions[index].binary = func;
+    return CALC_SUCCESS;
 }
\ No newline at end of file
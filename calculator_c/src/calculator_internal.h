@@ -0,0 +1,96 @@
+#ifndef CALCULATOR_INTERNAL_H
+#define CALCULATOR_INTERNAL_H
+
+#include "calculator.h"
+#include "arena.h"
+#include "evaluator.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Внутреннее устройство контекста калькулятора.
+ * Заголовок не входит в публичный API: он нужен модулям библиотеки,
+ * которым требуется прямой доступ к ячейкам переменных.
+ */
+
+/**
+ * Ячейка переменной.
+ * Номер ячейки не меняется и ячейка не удаляется до уничтожения контекста, поэтому
+ * скомпилированные выражения ссылаются на переменные по номеру ячейки.
+ * Массив ячеек может быть перевыделен при росте, поэтому указатели на ячейки не хранятся.
+ * Ячейка может быть создана для имени, которому еще не присвоено значение.
+ * Значения хранятся отдельно от имен, в окружении (calc_env_t).
+ */
+typedef struct {
+    char* name;   // Имя переменной
+    size_t hash;  // Хеш имени, чтобы не вычислять его при росте таблицы
+} calc_slot_t;
+
+/**
+ * Значение переменной в окружении
+ */
+typedef struct {
+    double value; // Значение переменной
+    bool defined; // Было ли переменной присвоено значение
+} calc_value_t;
+
+/**
+ * Окружение: значения переменных по номерам ячеек контекста.
+ * Контекст хранит свое окружение, которым пользуются calc_set_slot и calc_eval_compiled;
+ * отдельные окружения (calc_env_create) позволяют вычислять одни и те же
+ * скомпилированные выражения в нескольких потоках, не изменяя контекст.
+ * Окружение может быть короче числа ячеек контекста: ячейки, созданные
+ * после него, считаются не имеющими значения.
+ */
+struct calc_env_t {
+    const calculator_ctx_t* ctx; // Контекст, ячейкам которого соответствуют значения
+    calc_value_t* values;        // Значения по номерам ячеек
+    size_t num_values;           // Число значений
+};
+
+/**
+ * Зарегистрированная функция.
+ * Имени соответствует одна запись, в которой может быть задана функция одного
+ * аргумента, двух аргументов или обе. Как и ячейки переменных, записи не перемещаются
+ * по номерам и не удаляются, поэтому программы вызывают функции по номеру записи.
+ * Запись может быть создана при компиляции для еще не зарегистрированного имени:
+ * вызов такой функции - недопустимая операция, пока она не будет зарегистрирована.
+ */
+typedef struct {
+    char* name;            // Имя функции
+    unary_op_func unary;   // Функция одного аргумента или NULL
+    binary_op_func binary; // Функция двух аргументов или NULL
+} calc_function_t;
+
+/**
+ * Переменные хранятся в плотном массиве ячеек, а для поиска по имени используется
+ * хеш-таблица с открытой адресацией (линейное пробирование): корзина содержит
+ * номер ячейки плюс один, ноль - пустая корзина. Число корзин - степень двойки,
+ * таблица расширяется вдвое, когда заполняется больше чем наполовину.
+ * Переменные не удаляются, поэтому пометки удаленных корзин не нужны.
+ */
+struct calculator_ctx_t {
+    calc_slot_t* variables;  // Ячейки переменных в порядке создания
+    size_t num_variables;    // Число ячеек
+    size_t capacity;         // Размер массива ячеек и массива значений окружения
+    calc_env_t env;          // Окружение контекста: значения всех его ячеек
+    size_t* buckets;         // Корзины хеш-таблицы
+    size_t num_buckets;      // Число корзин
+    calc_function_t* functions;   // Зарегистрированные функции
+    size_t num_functions;         // Число записей о функциях
+    size_t functions_capacity;    // Размер массива записей
+    arena_t* arena;          // Арена разбора: анализаторы и АСД, сбрасывается после компиляции
+    evaluator_t* evaluator;
+};
+
+/**
+ * Возвращает номер записи о функции, создавая пустую запись, если имени еще нет
+ * Имена сравниваются только здесь, при компиляции выражения
+ * @param ctx Указатель на контекст калькулятора
+ * @param name Имя функции
+ * @param index Указатель для записи номера
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+calc_error_t calc_bind_function(calculator_ctx_t* ctx, const char* name, size_t* index);
+
+#endif // CALCULATOR_INTERNAL_H
@@ -1,24 +1,95 @@
 #include "evaluator.h"
+#include "calculator_internal.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdbool.h>
 
 #define PI 3.1415926535
 
+// Глубина стека, которая помещается в локальный буфер; более глубоким
+// выражениям стек выделяется в куче на время вычисления
+#define LOCAL_STACK_SIZE 64
+
+// Число строк, которые пакетное вычисление проводит через программу за один проход:
+// каждая ячейка стека - столбец такой длины, и он должен помещаться в кэш
+#define BATCH_BLOCK 256
+
+/**
+ * Коды инструкций стековой машины
+ */
+typedef enum {
+    OP_CONST,   // Положить константу
+    OP_VAR,     // Положить значение переменной из ячейки
+    OP_NEG,     // Унарный минус
+    OP_SIN,     // Синус
+    OP_COS,     // Косинус
+    OP_FACT,    // Факториал
+    OP_ADD,     // Сложение
+    OP_SUB,     // Вычитание
+    OP_MUL,     // Умножение
+    OP_DIV,     // Деление с проверкой делителя
+    OP_POW,     // Возведение в степень
+    OP_CALL1,   // Вызов зарегистрированной функции одного аргумента
+    OP_CALL2,   // Вызов зарегистрированной функции двух аргументов
+    OP_INVALID  // Неизвестная операция: ошибка при выполнении, как и прежде
+} opcode_t;
+
+/**
+ * Инструкция: код операции и непосредственный операнд
+ */
+typedef struct {
+    opcode_t opcode;
+    union {
+        double number;   // Константа для OP_CONST
+        size_t slot;     // Номер ячейки для OP_VAR
+        size_t function; // Номер записи о функции для OP_CALL1 и OP_CALL2
+    } arg;
+} instruction_t;
+
+/**
+ * Программа размещается одним блоком памяти вместе со своими инструкциями
+ */
+struct program_t {
+    size_t length;         // Число инструкций
+    size_t max_depth;      // Наибольшая глубина стека при выполнении
+    instruction_t code[];  // Инструкции в порядке выполнения (обратная польская запись)
+};
+
 struct evaluator_t {
     calculator_ctx_t* calc_ctx;
+    instruction_t* buffer;     // Буфер для инструкций компилируемой программы,
+    size_t buffer_capacity;    // сохраняемый между компиляциями
 };
 
+/**
+ * Состояние компиляции программы
+ */
+typedef struct {
+    evaluator_t* eval;
+    instruction_t* code;
+    size_t length;
+    size_t capacity;
+    size_t depth;      // Текущая глубина стека
+    size_t max_depth;  // Наибольшая глубина стека
+    calc_error_t error;
+} compiler_t;
+
 evaluator_t* evaluator_create(calculator_ctx_t* calc_ctx) {
     evaluator_t* eval = malloc(sizeof(evaluator_t));
     if (eval) {
         eval->calc_ctx = calc_ctx;
+        eval->buffer = NULL;
+        eval->buffer_capacity = 0;
     }
     return eval;
 }
 
 void evaluator_destroy(evaluator_t* eval) {
-    free(eval);
+    if (eval) {
+        free(eval->buffer);
+        free(eval);
+    }
 }
 
 static double factorial(double n) {
@@ -30,71 +101,431 @@ static double factorial(double n) {
     return n * factorial(n - 1);
 }
 
-calc_error_t evaluator_evaluate(evaluator_t* eval, ast_node_t* node, double* result) {
-    if (!node) return CALC_ERROR_SYNTAX;
-    
+/**
+ * Добавляет инструкцию в программу и отслеживает глубину стека.
+ *
+ * @param compiler Состояние компиляции
+ * @param instruction Добавляемая инструкция
+ * @param pops Сколько значений инструкция снимает со стека
+ */
+static void emit(compiler_t* compiler, instruction_t instruction, size_t pops) {
+    if (compiler->error != CALC_SUCCESS) return;
+
+    if (compiler->length == compiler->capacity) {
+        size_t capacity = compiler->capacity ? compiler->capacity * 2 : 16;
+        instruction_t* code = realloc(compiler->code, capacity * sizeof(instruction_t));
+        if (!code) {
+            compiler->error = CALC_ERROR_SYNTAX;
+            return;
+        }
+        compiler->code = code;
+        compiler->capacity = capacity;
+    }
+    compiler->code[compiler->length++] = instruction;
+
+    // Каждая инструкция кладет на стек ровно одно значение
+    compiler->depth = compiler->depth - pops + 1;
+    if (compiler->depth > compiler->max_depth) {
+        compiler->max_depth = compiler->depth;
+    }
+}
+
+/**
+ * Возвращает код инструкции для встроенной унарной операции или функции.
+ * Имена сравниваются только здесь, при компиляции.
+ *
+ * @param name Имя операции
+ * @return Код инструкции (OP_CALL1, если операция не встроенная)
+ */
+static opcode_t unary_opcode(const char* name) {
+    if (strcmp(name, "-") == 0) return OP_NEG;
+    if (strcmp(name, "sin") == 0) return OP_SIN;
+    if (strcmp(name, "cos") == 0) return OP_COS;
+    if (strcmp(name, "!") == 0) return OP_FACT;
+    return OP_CALL1;
+}
+
+bool evaluator_is_builtin(const char* name) {
+    return unary_opcode(name) != OP_CALL1;
+}
+
+/**
+ * Возвращает код инструкции для бинарной операции.
+ *
+ * @param oper Символ операции
+ * @return Код инструкции (OP_INVALID для неизвестной операции)
+ */
+static opcode_t binary_opcode(char oper) {
+    switch (oper) {
+        case '+': return OP_ADD;
+        case '-': return OP_SUB;
+        case '*': return OP_MUL;
+        case '/': return OP_DIV;
+        case '^': return OP_POW;
+        default: return OP_INVALID;
+    }
+}
+
+/**
+ * Компилирует поддерево AST: сначала операнды, затем сама операция,
+ * поэтому ошибки при выполнении возникают в том же порядке, что и при обходе дерева.
+ *
+ * @param compiler Состояние компиляции
+ * @param node Узел AST
+ */
+static void compile_node(compiler_t* compiler, const ast_node_t* node) {
+    instruction_t instruction;
+
+    if (!node) {
+        compiler->error = CALC_ERROR_SYNTAX;
+        return;
+    }
+
     switch (node->type) {
         case AST_NUMBER:
-            *result = node->value.number;
-            return CALC_SUCCESS;
-            
-        case AST_VARIABLE: {
-            double value;
+            instruction.opcode = OP_CONST;
+            instruction.arg.number = node->value.number;
+            emit(compiler, instruction, 0);
+            return;
+
+        case AST_VARIABLE:
+            // Встроенная константа PI имеет приоритет над переменной с тем же именем
             if (strcmp(node->value.variable, "PI") == 0) {
-                *result = PI;
-                return CALC_SUCCESS;
+                instruction.opcode = OP_CONST;
+                instruction.arg.number = PI;
+            } else {
+                instruction.opcode = OP_VAR;
+                calc_error_t err = calc_bind_variable(compiler->eval->calc_ctx,
+                                                      node->value.variable, &instruction.arg.slot);
+                if (err != CALC_SUCCESS) {
+                    compiler->error = err;
+                    return;
+                }
             }
-            if (calc_get_variable(eval->calc_ctx, node->value.variable, &value) != CALC_SUCCESS) {
-                return CALC_ERROR_UNDEFINED_VAR;
+            emit(compiler, instruction, 0);
+            return;
+
+        case AST_UNARY_OP:
+            compile_node(compiler, node->value.unary_op.operand);
+            instruction.opcode = unary_opcode(node->value.unary_op.oper);
+            if (instruction.opcode == OP_CALL1) {
+                // Имя функции разрешается в номер записи реестра контекста
+                calc_error_t err = calc_bind_function(compiler->eval->calc_ctx, node->value.unary_op.oper,
+                                                      &instruction.arg.function);
+                if (err != CALC_SUCCESS) {
+                    compiler->error = err;
+                    return;
+                }
             }
-            *result = value;
-            return CALC_SUCCESS;
+            emit(compiler, instruction, 1);
+            return;
+
+        case AST_BINARY_OP:
+            compile_node(compiler, node->value.binary_op.left);
+            compile_node(compiler, node->value.binary_op.right);
+            instruction.opcode = binary_opcode(node->value.binary_op.oper);
+            // Неизвестная бинарная операция снимает оба операнда
+            emit(compiler, instruction, 2);
+            return;
+
+        case AST_BINARY_FUNC: {
+            compile_node(compiler, node->value.binary_func.left);
+            compile_node(compiler, node->value.binary_func.right);
+            instruction.opcode = OP_CALL2;
+            calc_error_t err = calc_bind_function(compiler->eval->calc_ctx, node->value.binary_func.name,
+                                                  &instruction.arg.function);
+            if (err != CALC_SUCCESS) {
+                compiler->error = err;
+                return;
+            }
+            emit(compiler, instruction, 2);
+            return;
         }
-        
-        case AST_UNARY_OP: {
-            double operand;
-            calc_error_t err = evaluator_evaluate(eval, node->value.unary_op.operand, &operand);
-            if (err != CALC_SUCCESS) return err;
-            
-            if (strcmp(node->value.unary_op.oper, "-") == 0) {
-                *result = -operand;
-            } else if (strcmp(node->value.unary_op.oper, "sin") == 0) {
-                *result = sin(operand);
-            } else if (strcmp(node->value.unary_op.oper, "cos") == 0) {
-                *result = cos(operand);
-            } else if (strcmp(node->value.unary_op.oper, "!") == 0) {
-                *result = factorial(operand);
+    }
+    compiler->error = CALC_ERROR_SYNTAX;
+}
+
+program_t* evaluator_compile(evaluator_t* eval, const ast_node_t* node) {
+    if (!eval || !node) return NULL;
+
+    // Инструкции собираются в буфере вычислителя, который растет и переиспользуется,
+    // а готовая программа копируется в один блок точного размера
+    compiler_t compiler = {eval, eval->buffer, 0, eval->buffer_capacity, 0, 0, CALC_SUCCESS};
+    compile_node(&compiler, node);
+    eval->buffer = compiler.code;
+    eval->buffer_capacity = compiler.capacity;
+    if (compiler.error != CALC_SUCCESS) return NULL;
+
+    program_t* program = malloc(sizeof(program_t) + compiler.length * sizeof(instruction_t));
+    if (!program) return NULL;
+    program->length = compiler.length;
+    program->max_depth = compiler.max_depth;
+    memcpy(program->code, compiler.code, compiler.length * sizeof(instruction_t));
+    return program;
+}
+
+void program_destroy(program_t* program) {
+    free(program);
+}
+
+/**
+ * Выполняет инструкции программы на заранее выделенном стеке.
+ *
+ * @param program Указатель на программу
+ * @param functions Реестр функций контекста
+ * @param env Окружение со значениями переменных
+ * @param stack Стек глубиной не меньше program->max_depth
+ * @param result Указатель для записи результата вычисления
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+static calc_error_t execute(const program_t* program, const calc_function_t* functions,
+                            const calc_env_t* env, double* stack, double* result) {
+    const calc_value_t* values = env->values;
+    size_t num_values = env->num_values;
+    const instruction_t* ip = program->code;
+    const instruction_t* end = ip + program->length;
+    double* top = stack - 1;  // Вершина стека
+
+    for (; ip != end; ++ip) {
+        switch (ip->opcode) {
+            case OP_CONST:
+                *++top = ip->arg.number;
+                break;
+            case OP_VAR: {
+                size_t slot = ip->arg.slot;
+                if (slot >= num_values || !values[slot].defined) return CALC_ERROR_UNDEFINED_VAR;
+                *++top = values[slot].value;
+                break;
+            }
+            case OP_NEG:
+                *top = -*top;
+                break;
+            case OP_SIN:
+                *top = sin(*top);
+                break;
+            case OP_COS:
+                *top = cos(*top);
+                break;
+            case OP_FACT:
+                *top = factorial(*top);
                 // Проверяем результат factorial на NaN
-                if (isnan(*result)) {
-                    return CALC_ERROR_INVALID_OPERATION;
-                }
-            } else {
-                return CALC_ERROR_INVALID_OPERATION;
+                if (isnan(*top)) return CALC_ERROR_INVALID_OPERATION;
+                break;
+            case OP_ADD:
+                top[-1] += top[0];
+                --top;
+                break;
+            case OP_SUB:
+                top[-1] -= top[0];
+                --top;
+                break;
+            case OP_MUL:
+                top[-1] *= top[0];
+                --top;
+                break;
+            case OP_DIV:
+                if (top[0] == 0) return CALC_ERROR_INVALID_OPERATION;
+                top[-1] /= top[0];
+                --top;
+                break;
+            case OP_POW:
+                top[-1] = pow(top[-1], top[0]);
+                --top;
+                break;
+            case OP_CALL1: {
+                unary_op_func func = functions[ip->arg.function].unary;
+                if (!func) return CALC_ERROR_INVALID_OPERATION;
+                *top = func(*top);
+                break;
+            }
+            case OP_CALL2: {
+                binary_op_func func = functions[ip->arg.function].binary;
+                if (!func) return CALC_ERROR_INVALID_OPERATION;
+                top[-1] = func(top[-1], top[0]);
+                --top;
+                break;
             }
-            return CALC_SUCCESS;
+            case OP_INVALID:
+            default:
+                return CALC_ERROR_INVALID_OPERATION;
         }
-        
-        case AST_BINARY_OP: {
-            double left, right;
-            calc_error_t err = evaluator_evaluate(eval, node->value.binary_op.left, &left);
-            if (err != CALC_SUCCESS) return err;
-            
-            err = evaluator_evaluate(eval, node->value.binary_op.right, &right);
-            if (err != CALC_SUCCESS) return err;
-            
-            switch (node->value.binary_op.oper) {
-                case '+': *result = left + right; break;
-                case '-': *result = left - right; break;
-                case '*': *result = left * right; break;
-                case '/':
-                    if (right == 0) return CALC_ERROR_INVALID_OPERATION;
-                    *result = left / right;
-                    break;
-                case '^': *result = pow(left, right); break;
-                default: return CALC_ERROR_INVALID_OPERATION;
+    }
+
+    *result = *top;
+    return CALC_SUCCESS;
+}
+
+calc_error_t evaluator_run(const evaluator_t* eval, const program_t* program,
+                           const calc_env_t* env, double* result) {
+    if (!eval || !program || !result || program->length == 0) return CALC_ERROR_SYNTAX;
+
+    // Стек выполнения свой у каждого вызова, поэтому вызовы независимы друг от друга
+    const calc_function_t* functions = eval->calc_ctx->functions;
+    if (!env) env = &eval->calc_ctx->env;
+    if (program->max_depth <= LOCAL_STACK_SIZE) {
+        double stack[LOCAL_STACK_SIZE];
+        return execute(program, functions, env, stack, result);
+    }
+
+    double* stack = malloc(program->max_depth * sizeof(double));
+    if (!stack) return CALC_ERROR_INVALID_OPERATION;
+    calc_error_t error = execute(program, functions, env, stack, result);
+    free(stack);
+    return error;
+}
+
+/**
+ * Заполняет столбец стека одним значением.
+ *
+ * @param column Столбец стека
+ * @param count Число строк
+ * @param value Значение
+ */
+static void fill_column(double* restrict column, size_t count, double value) {
+    for (size_t i = 0; i < count; i++) {
+        column[i] = value;
+    }
+}
+
+/**
+ * Выполняет программу для блока строк: каждая инструкция обрабатывает
+ * сразу весь блок, поэтому внутренние циклы векторизуются компилятором.
+ *
+ * @param program Указатель на программу
+ * @param functions Реестр функций контекста
+ * @param env Окружение со значениями переменных без столбцов
+ * @param columns Столбцы значений переменных по номерам ячеек (допускается NULL)
+ * @param first Номер первой строки блока
+ * @param count Число строк в блоке (не больше BATCH_BLOCK)
+ * @param stack Стек из program->max_depth столбцов по BATCH_BLOCK значений
+ * @param out Массив результатов
+ * @return Код ошибки (CALC_SUCCESS при успехе)
+ */
+static calc_error_t execute_block(const program_t* program, const calc_function_t* functions,
+                                  const calc_env_t* env, const double* const* columns,
+                                  size_t first, size_t count, double* stack, double* out) {
+    const instruction_t* ip = program->code;
+    const instruction_t* end = ip + program->length;
+    double* next = stack;  // Первый свободный столбец стека
+
+    for (; ip != end; ++ip) {
+        switch (ip->opcode) {
+            case OP_CONST:
+                fill_column(next, count, ip->arg.number);
+                next += BATCH_BLOCK;
+                break;
+
+            case OP_VAR: {
+                const double* column = columns ? columns[ip->arg.slot] : NULL;
+                if (column) {
+                    memcpy(next, column + first, count * sizeof(double));
+                } else {
+                    // Переменная без столбца берется из окружения и одинакова для всех строк
+                    size_t slot = ip->arg.slot;
+                    if (slot >= env->num_values || !env->values[slot].defined) return CALC_ERROR_UNDEFINED_VAR;
+                    fill_column(next, count, env->values[slot].value);
+                }
+                next += BATCH_BLOCK;
+                break;
             }
-            return CALC_SUCCESS;
+
+            case OP_NEG: case OP_SIN: case OP_COS: case OP_FACT: {
+                double* restrict top = next - BATCH_BLOCK;  // Операнд на вершине стека
+                bool invalid = false;
+                switch (ip->opcode) {
+                    case OP_NEG:
+                        for (size_t i = 0; i < count; i++) top[i] = -top[i];
+                        break;
+                    case OP_SIN:
+                        for (size_t i = 0; i < count; i++) top[i] = sin(top[i]);
+                        break;
+                    case OP_COS:
+                        for (size_t i = 0; i < count; i++) top[i] = cos(top[i]);
+                        break;
+                    default:
+                        for (size_t i = 0; i < count; i++) {
+                            top[i] = factorial(top[i]);
+                            invalid |= isnan(top[i]);
+                        }
+                        break;
+                }
+                if (invalid) return CALC_ERROR_INVALID_OPERATION;
+                break;
+            }
+
+            case OP_CALL1: {
+                double* restrict top = next - BATCH_BLOCK;
+                unary_op_func func = functions[ip->arg.function].unary;
+                if (!func) return CALC_ERROR_INVALID_OPERATION;
+                for (size_t i = 0; i < count; i++) top[i] = func(top[i]);
+                break;
+            }
+
+            case OP_CALL2: {
+                double* restrict a = next - 2 * BATCH_BLOCK;
+                const double* restrict b = next - BATCH_BLOCK;
+                binary_op_func func = functions[ip->arg.function].binary;
+                if (!func) return CALC_ERROR_INVALID_OPERATION;
+                for (size_t i = 0; i < count; i++) a[i] = func(a[i], b[i]);
+                next -= BATCH_BLOCK;
+                break;
+            }
+
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW: {
+                double* restrict a = next - 2 * BATCH_BLOCK;  // Левый операнд, сюда же пишется результат
+                const double* restrict b = next - BATCH_BLOCK; // Правый операнд
+                switch (ip->opcode) {
+                    case OP_ADD:
+                        for (size_t i = 0; i < count; i++) a[i] += b[i];
+                        break;
+                    case OP_SUB:
+                        for (size_t i = 0; i < count; i++) a[i] -= b[i];
+                        break;
+                    case OP_MUL:
+                        for (size_t i = 0; i < count; i++) a[i] *= b[i];
+                        break;
+                    case OP_DIV: {
+                        bool zero = false;
+                        for (size_t i = 0; i < count; i++) zero |= b[i] == 0;
+                        if (zero) return CALC_ERROR_INVALID_OPERATION;
+                        for (size_t i = 0; i < count; i++) a[i] /= b[i];
+                        break;
+                    }
+                    default:
+                        for (size_t i = 0; i < count; i++) a[i] = pow(a[i], b[i]);
+                        break;
+                }
+                next -= BATCH_BLOCK;
+                break;
+            }
+
+            case OP_INVALID:
+            default:
+                return CALC_ERROR_INVALID_OPERATION;
         }
     }
-    return CALC_ERROR_SYNTAX;
-}
\ No newline at end of file
+
+    memcpy(out + first, next - BATCH_BLOCK, count * sizeof(double));
+    return CALC_SUCCESS;
+}
+
+calc_error_t evaluator_run_batch(const evaluator_t* eval, const program_t* program, const calc_env_t* env,
+                                 const double* const* columns, size_t n, double* out) {
+    if (!eval || !program || (n > 0 && !out) || program->length == 0) return CALC_ERROR_SYNTAX;
+    if (n == 0) return CALC_SUCCESS;
+
+    const calc_function_t* functions = eval->calc_ctx->functions;
+    if (!env) env = &eval->calc_ctx->env;
+
+    double* stack = malloc(program->max_depth * BATCH_BLOCK * sizeof(double));
+    if (!stack) return CALC_ERROR_INVALID_OPERATION;
+
+    calc_error_t error = CALC_SUCCESS;
+    for (size_t first = 0; first < n && error == CALC_SUCCESS; first += BATCH_BLOCK) {
+        size_t count = n - first < BATCH_BLOCK ? n - first : BATCH_BLOCK;
+        error = execute_block(program, functions, env, columns, first, count, stack, out);
+    }
+
+    free(stack);
+    return error;
+}
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 struct lexer_t {
+    arena_t* arena;        // Арена для идентификаторов
     const char* input;     // Входная строка для анализа
     size_t position;       // Текущая позиция в строке
     size_t length;         // Длина входной строки
@@ -24,12 +25,14 @@ static bool is_identifier_char(char c) {
 /**
  * Создает лексический анализатор для заданной входной строки.
  * 
+ * @param arena Арена, в которой размещаются анализатор и идентификаторы
  * @param input Строка с выражением для анализа
  * @return Указатель на созданный лексический анализатор или NULL при ошибке
  */
-lexer_t* lexer_create(const char* input) {
-    lexer_t* lexer = malloc(sizeof(lexer_t));
+lexer_t* lexer_create(arena_t* arena, const char* input) {
+    lexer_t* lexer = arena_alloc(arena, sizeof(lexer_t));
     if (lexer) {
+        lexer->arena = arena;
         lexer->input = input;
         lexer->position = 0;
         lexer->length = strlen(input);
@@ -37,15 +40,6 @@ lexer_t* lexer_create(const char* input) {
     return lexer;
 }
 
-/**
- * Освобождает ресурсы, занятые лексическим анализатором.
- * 
- * @param lexer Указатель на лексический анализатор
- */
-void lexer_destroy(lexer_t* lexer) {
-    free(lexer);
-}
-
 /**
  * Пропускает пробельные символы в входной строке.
  * Перемещает текущую позицию до первого непробельного символа.
@@ -94,11 +88,11 @@ static token_t parse_identifier(lexer_t* lexer) {
         lexer->position++;
     }
     
-    // Выделяем память для идентификатора и копируем его
-    size_t length = lexer->position - start;
-    token.value.identifier = malloc(length + 1);
-    strncpy(token.value.identifier, lexer->input + start, length);
-    token.value.identifier[length] = '\0';
+    // Копируем идентификатор в арену: эта копия переходит в AST без повторного копирования
+    token.value.identifier = arena_strndup(lexer->arena, lexer->input + start, lexer->position - start);
+    if (!token.value.identifier) {
+        token.type = TOKEN_ERROR;
+    }
     
     return token;
 }
@@ -158,6 +152,9 @@ token_t lexer_next_token(lexer_t* lexer) {
         case ']':
             token.type = TOKEN_RBRACKET;
             break;
+        case ',':
+            token.type = TOKEN_COMMA;
+            break;
         default:
             token.type = TOKEN_ERROR;
             return token;
@@ -166,15 +163,3 @@ token_t lexer_next_token(lexer_t* lexer) {
     lexer->position++;
     return token;
 }
-
-/**
- * Освобождает ресурсы, занятые токеном.
- * Если токен содержит идентификатор, освобождает память, выделенную для него.
- * 
- * @param token Указатель на токен
- */
-void token_destroy(token_t* token) {
-    if (token && token->type == TOKEN_IDENTIFIER) {
-        free(token->value.identifier);
-    }
-}
\ No newline at end of file
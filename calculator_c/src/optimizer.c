@@ -0,0 +1,136 @@
+#include "optimizer.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PI 3.1415926535
+
+// Наибольший показатель степени, которую выгоднее вычислить цепочкой умножений, чем pow
+#define MAX_POWER_CHAIN 8
+
+/**
+ * Проверяет, является ли узел числом с заданным значением.
+ *
+ * @param node Узел AST
+ * @param value Ожидаемое значение
+ * @return true если узел - число value, иначе false
+ */
+static bool is_number(const ast_node_t* node, double value) {
+    return node->type == AST_NUMBER && node->value.number == value;
+}
+
+/**
+ * Пытается свернуть узел, все операнды которого уже числа.
+ * Значение вычисляется тем же вычислителем, что и при выполнении выражения,
+ * поэтому свернутая константа совпадает с результатом вычисления узла.
+ * Замененные узлы остаются в арене до ее сброса.
+ *
+ * @param eval Указатель на вычислитель выражений
+ * @param arena Арена для нового узла
+ * @param node Узел AST с числовыми операндами
+ * @return Числовой узел, заменивший node, или сам node, если свернуть нельзя
+ */
+static ast_node_t* fold(evaluator_t* eval, arena_t* arena, ast_node_t* node) {
+    program_t* program = evaluator_compile(eval, node);
+    if (!program) return node;
+
+    double value;
+    calc_error_t error = evaluator_run(eval, program, NULL, &value);
+    program_destroy(program);
+    if (error != CALC_SUCCESS) {
+        // Ошибку сообщит вычисление выражения, свертка ее бы скрыла
+        return node;
+    }
+
+    ast_node_t* number = ast_create_number(arena, value);
+    return number ? number : node;
+}
+
+/**
+ * Заменяет x^n цепочкой умножений x*x*...*x.
+ *
+ * @param arena Арена для новых узлов
+ * @param node Узел возведения переменной в степень
+ * @param power Целый показатель степени (2 <= power <= MAX_POWER_CHAIN)
+ * @return Корень цепочки умножений или сам node при ошибке выделения памяти
+ */
+static ast_node_t* expand_power(arena_t* arena, ast_node_t* node, int power) {
+    ast_node_t* variable = node->value.binary_op.left;
+    ast_node_t* chain = variable;
+    // Узел переменной неизменяем, поэтому один и тот же узел служит всеми множителями
+    for (int i = 1; chain && i < power; i++) {
+        chain = ast_create_binary_op(arena, '*', chain, variable);
+    }
+    return chain ? chain : node;
+}
+
+ast_node_t* optimizer_optimize(evaluator_t* eval, arena_t* arena, ast_node_t* node) {
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case AST_NUMBER:
+            return node;
+
+        case AST_VARIABLE:
+            // Встроенная константа PI имеет приоритет над переменной с тем же именем
+            if (strcmp(node->value.variable, "PI") == 0) {
+                ast_node_t* number = ast_create_number(arena, PI);
+                if (number) return number;
+            }
+            return node;
+
+        case AST_UNARY_OP:
+            node->value.unary_op.operand = optimizer_optimize(eval, arena, node->value.unary_op.operand);
+            // Зарегистрированные функции не сворачиваются: их можно заменить после компиляции
+            if (node->value.unary_op.operand && node->value.unary_op.operand->type == AST_NUMBER &&
+                evaluator_is_builtin(node->value.unary_op.oper)) {
+                return fold(eval, arena, node);
+            }
+            return node;
+
+        case AST_BINARY_FUNC:
+            node->value.binary_func.left = optimizer_optimize(eval, arena, node->value.binary_func.left);
+            node->value.binary_func.right = optimizer_optimize(eval, arena, node->value.binary_func.right);
+            return node;
+
+        case AST_BINARY_OP: {
+            ast_node_t** left = &node->value.binary_op.left;
+            ast_node_t** right = &node->value.binary_op.right;
+            *left = optimizer_optimize(eval, arena, *left);
+            *right = optimizer_optimize(eval, arena, *right);
+            if (!*left || !*right) return node;
+
+            if ((*left)->type == AST_NUMBER && (*right)->type == AST_NUMBER) {
+                return fold(eval, arena, node);
+            }
+
+            // Тождества, которые не меняют значение и не пропускают вычисление операнда
+            switch (node->value.binary_op.oper) {
+                case '+':
+                    if (is_number(*right, 0)) return *left;
+                    if (is_number(*left, 0)) return *right;
+                    break;
+                case '-':
+                    if (is_number(*right, 0)) return *left;
+                    break;
+                case '*':
+                    if (is_number(*right, 1)) return *left;
+                    if (is_number(*left, 1)) return *right;
+                    break;
+                case '/':
+                    if (is_number(*right, 1)) return *left;
+                    break;
+                case '^':
+                    if (is_number(*right, 1)) return *left;
+                    if ((*left)->type == AST_VARIABLE) {
+                        for (int power = 2; power <= MAX_POWER_CHAIN; power++) {
+                            if (is_number(*right, power)) return expand_power(arena, node, power);
+                        }
+                    }
+                    break;
+            }
+            return node;
+        }
+    }
+    return node;
+}
@@ -0,0 +1,163 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "calculator.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Бенчмарк многопоточного вычисления: одно скомпилированное выражение
+ * вычисляется одновременно в 1, 2, 4, ... потоках, у каждого потока свое окружение.
+ * Потоки не разделяют изменяемых данных, поэтому пропускная способность
+ * должна расти линейно с числом ядер.
+ *
+ * Запуск: bench_threads [число вычислений на поток [наибольшее число потоков]]
+ * По умолчанию наибольшее число потоков равно числу ядер.
+ */
+
+#define DEFAULT_ITERATIONS 2000000
+
+#define EXPRESSION "sin(x) * cos(y) + (x - y) ^ 2 / (x * x + 1) - 3 * x + y / 7"
+
+typedef struct {
+    const calculator_ctx_t* calc;
+    const calc_expr_t* expr;
+    size_t x_slot;
+    size_t y_slot;
+    long iterations;
+    double sum;       // Сумма результатов, чтобы вычисления не были выброшены
+    int failed;
+} worker_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* worker_run(void* arg) {
+    worker_t* worker = arg;
+    // Окружение создается в своем потоке, чтобы значения разных потоков
+    // не оказались в одной строке кэша
+    calc_env_t* env = calc_env_create(worker->calc);
+    if (!env) {
+        worker->failed = 1;
+        return NULL;
+    }
+
+    double sum = 0.0;
+    double result;
+    for (long i = 0; i < worker->iterations; i++) {
+        calc_env_set_slot(env, worker->x_slot, (double)(i % 1000) / 100.0);
+        calc_env_set_slot(env, worker->y_slot, (double)(i % 37));
+        if (calc_eval_env(worker->expr, env, &result) != CALC_SUCCESS) {
+            worker->failed = 1;
+            break;
+        }
+        sum += result;
+    }
+    worker->sum = sum;
+    calc_env_destroy(env);
+    return NULL;
+}
+
+/**
+ * Запускает заданное число потоков и возвращает время их работы в секундах
+ * или отрицательное значение при ошибке.
+ */
+static double run_threads(const calculator_ctx_t* calc, const calc_expr_t* expr, size_t x_slot, size_t y_slot,
+                          int num_threads, long iterations, double* sum) {
+    worker_t* workers = calloc(num_threads, sizeof(worker_t));
+    pthread_t* threads = calloc(num_threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        free(workers);
+        free(threads);
+        return -1.0;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].calc = calc;
+        workers[t].expr = expr;
+        workers[t].x_slot = x_slot;
+        workers[t].y_slot = y_slot;
+        workers[t].iterations = iterations;
+    }
+
+    double start = now_seconds();
+    int created = 0;
+    for (; created < num_threads; created++) {
+        if (pthread_create(&threads[created], NULL, worker_run, &workers[created]) != 0) break;
+    }
+    for (int t = 0; t < created; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    int failed = created != num_threads;
+    *sum = 0.0;
+    for (int t = 0; t < num_threads; t++) {
+        failed |= workers[t].failed;
+        *sum += workers[t].sum;
+    }
+    free(workers);
+    free(threads);
+    return failed ? -1.0 : elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long max_threads = argc > 2 ? atol(argv[2]) : cores;
+    if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+    if (max_threads < 1) max_threads = cores > 0 ? cores : 1;
+
+    calculator_ctx_t* calc = calc_create();
+    calc_expr_t* expr = calc ? calc_compile(calc, EXPRESSION) : NULL;
+    size_t x_slot, y_slot;
+    if (!expr || calc_bind_variable(calc, "x", &x_slot) != CALC_SUCCESS ||
+        calc_bind_variable(calc, "y", &y_slot) != CALC_SUCCESS) {
+        fprintf(stderr, "Не удалось скомпилировать выражение\n");
+        calc_destroy(calc);
+        return 1;
+    }
+
+    printf("Выражение: %s\n", EXPRESSION);
+    printf("Вычислений на поток: %ld, ядер: %ld\n\n", iterations, cores);
+    printf("  Потоки     Время, с     Вычислений/с  Ускорение\n");
+
+    double single_sum = 0.0;
+    double single_rate = 0.0;
+    int status = 0;
+    for (long num_threads = 1; num_threads <= max_threads; ) {
+        double sum;
+        double elapsed = run_threads(calc, expr, x_slot, y_slot, (int)num_threads, iterations, &sum);
+        if (elapsed < 0) {
+            fprintf(stderr, "Ошибка вычисления в %ld потоках\n", num_threads);
+            status = 1;
+            break;
+        }
+
+        // Все потоки вычисляют одну и ту же последовательность значений
+        if (num_threads == 1) single_sum = sum;
+        if (fabs(sum - single_sum * num_threads) > 1e-6 * fabs(single_sum * num_threads)) {
+            fprintf(stderr, "Результаты в %ld потоках не совпадают с однопоточными\n", num_threads);
+            status = 1;
+            break;
+        }
+
+        double rate = (double)iterations * num_threads / elapsed;
+        if (num_threads == 1) single_rate = rate;
+        printf("%8ld %12.3f %16.0f %9.2fx\n", num_threads, elapsed, rate, rate / single_rate);
+
+        // Число ядер может не быть степенью двойки: последним замером берем все ядра
+        if (num_threads == max_threads) break;
+        num_threads = num_threads * 2 < max_threads ? num_threads * 2 : max_threads;
+    }
+
+    calc_expr_free(expr);
+    calc_destroy(calc);
+    return status;
+}
@@ -128,6 +128,416 @@ static void test_complex_expressions(void) {
     printf("Complex expression tests passed\n");
 }
 
+static void test_compiled_expressions(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    
+    calc_set_variable(calc, "x", 1.0);
+    calc_expr_t* expr = calc_compile(calc, "2 * x + sin(PI/2)");
+    assert(expr != NULL);
+    
+    // Переменные читаются при каждом вычислении, а не при компиляции
+    for (int i = 0; i < 10; i++) {
+        calc_set_variable(calc, "x", (double)i);
+        assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+        assert(double_eq(result, 2.0 * i + 1.0));
+    }
+    calc_expr_free(expr);
+    
+    // Синтаксическая ошибка обнаруживается при компиляции
+    assert(calc_compile(calc, "1 + + 2") == NULL);
+    assert(calc_compile(calc, "(1 + 2") == NULL);
+    
+    // Ошибки вычисления сообщаются при каждом вызове
+    expr = calc_compile(calc, "1 / x + z");
+    assert(expr != NULL);
+    calc_set_variable(calc, "x", 0.0);
+    assert(calc_eval_compiled(expr, &result) == CALC_ERROR_INVALID_OPERATION);
+    calc_set_variable(calc, "x", 2.0);
+    assert(calc_eval_compiled(expr, &result) == CALC_ERROR_UNDEFINED_VAR);
+    calc_set_variable(calc, "z", 1.5);
+    assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 2.0));
+    calc_expr_free(expr);
+    
+    calc_expr_free(NULL);
+    
+    calc_destroy(calc);
+    printf("Compiled expression tests passed\n");
+}
+
+static void test_deep_expressions(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    char expression[1024];
+    size_t length = 0;
+    
+    // "1+(1+(1+...))": глубина стека вычисления растет с вложенностью
+    for (int i = 0; i < 100; i++) {
+        length += sprintf(expression + length, "1+(");
+    }
+    length += sprintf(expression + length, "1");
+    for (int i = 0; i < 100; i++) {
+        expression[length++] = ')';
+    }
+    expression[length] = '\0';
+    
+    assert(calc_evaluate(calc, expression, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 101.0));
+    
+    // Неизвестная функция - ошибка вычисления, но только после ошибок в ее аргументе
+    assert(calc_evaluate(calc, "tan(1)", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "tan(w)", &result) == CALC_ERROR_UNDEFINED_VAR);
+    
+    calc_destroy(calc);
+    printf("Deep expression tests passed\n");
+}
+
+static void test_variable_slots(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    char name[32];
+    
+    // Таблица переменных растет без ограничения в 100 переменных
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "v%d", i);
+        assert(calc_set_variable(calc, name, (double)i) == CALC_SUCCESS);
+    }
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "v%d", i);
+        assert(calc_get_variable(calc, name, &result) == CALC_SUCCESS);
+        assert(double_eq(result, (double)i));
+    }
+    assert(calc_evaluate(calc, "v0 + v999 * v10", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 9990.0));
+    
+    // Ячейка привязывается до присвоения значения и не меняется при росте таблицы
+    size_t slot, same_slot;
+    assert(calc_bind_variable(calc, "rate", &slot) == CALC_SUCCESS);
+    assert(calc_get_variable(calc, "rate", &result) == CALC_ERROR_UNDEFINED_VAR);
+    assert(calc_get_slot(calc, slot, &result) == CALC_ERROR_UNDEFINED_VAR);
+    
+    calc_expr_t* expr = calc_compile(calc, "100 * rate");
+    assert(expr != NULL);
+    assert(calc_eval_compiled(expr, &result) == CALC_ERROR_UNDEFINED_VAR);
+    
+    for (int i = 1000; i < 2000; i++) {
+        sprintf(name, "v%d", i);
+        assert(calc_set_variable(calc, name, (double)i) == CALC_SUCCESS);
+    }
+    assert(calc_bind_variable(calc, "rate", &same_slot) == CALC_SUCCESS);
+    assert(same_slot == slot);
+    
+    for (int i = 0; i < 10; i++) {
+        assert(calc_set_slot(calc, slot, i * 0.5) == CALC_SUCCESS);
+        assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+        assert(double_eq(result, i * 50.0));
+    }
+    assert(calc_get_variable(calc, "rate", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 4.5));
+    calc_expr_free(expr);
+    
+    assert(calc_set_slot(calc, (size_t)-1, 1.0) == CALC_ERROR_UNDEFINED_VAR);
+    
+    calc_destroy(calc);
+    printf("Variable slot tests passed\n");
+}
+
+static void test_batch_evaluation(void) {
+    calculator_ctx_t* calc = calc_create();
+    enum { ROWS = 1000 };  // Больше одного блока пакетного вычисления
+    static double xs[ROWS], ys[ROWS], out[ROWS];
+    double result;
+    size_t x, y, z;
+    
+    assert(calc_bind_variable(calc, "x", &x) == CALC_SUCCESS);
+    assert(calc_bind_variable(calc, "y", &y) == CALC_SUCCESS);
+    assert(calc_bind_variable(calc, "z", &z) == CALC_SUCCESS);
+    for (int i = 0; i < ROWS; i++) {
+        xs[i] = i * 0.01;
+        ys[i] = 1.0 + i % 7;
+    }
+    
+    const double* columns[3];
+    columns[z] = NULL;
+    columns[x] = xs;
+    columns[y] = ys;
+    calc_expr_t* expr = calc_compile(calc, "2 * x ^ 2 - sin(x) / y + cos(PI * y) + 3!");
+    assert(expr != NULL);
+    assert(calc_eval_batch(expr, columns, ROWS, out) == CALC_SUCCESS);
+    
+    // Каждая строка совпадает с поштучным вычислением
+    for (int i = 0; i < ROWS; i++) {
+        calc_set_slot(calc, x, xs[i]);
+        calc_set_slot(calc, y, ys[i]);
+        assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+        assert(double_eq(out[i], result));
+    }
+    
+    // Переменная без столбца берется из контекста
+    calc_set_slot(calc, y, 2.0);
+    columns[y] = NULL;
+    assert(calc_eval_batch(expr, columns, ROWS, out) == CALC_SUCCESS);
+    calc_set_slot(calc, x, xs[123]);
+    assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+    assert(double_eq(out[123], result));
+    calc_expr_free(expr);
+    
+    // Ошибка в любой строке возвращается как ошибка всего пакета
+    expr = calc_compile(calc, "1 / (x - 5)");
+    columns[y] = ys;
+    assert(calc_eval_batch(expr, columns, ROWS, out) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_eval_batch(expr, columns, 500, out) == CALC_SUCCESS);
+    assert(double_eq(out[0], -0.2));
+    calc_expr_free(expr);
+    
+    expr = calc_compile(calc, "x + z");
+    assert(calc_eval_batch(expr, columns, ROWS, out) == CALC_ERROR_UNDEFINED_VAR);
+    assert(calc_eval_batch(expr, columns, 0, NULL) == CALC_SUCCESS);
+    calc_expr_free(expr);
+    
+    calc_destroy(calc);
+    printf("Batch evaluation tests passed\n");
+}
+
+static void test_optimized_expressions(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    
+    calc_set_variable(calc, "r", 2.0);
+    calc_set_variable(calc, "x", 3.0);
+    
+    // Свертка констант, в том числе PI, функций и факториала литерала
+    assert(calc_evaluate(calc, "2 * PI * r", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 4 * PI));
+    assert(calc_evaluate(calc, "sin(PI/6) * x + 4! - 2^10", &result) == CALC_SUCCESS);
+    assert(double_eq(result, sin(PI / 6) * 3.0 + 24.0 - 1024.0));
+    
+    // Тождества и целые степени
+    assert(calc_evaluate(calc, "x * 1 + 0 + 1 * x - 0", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 6.0));
+    assert(calc_evaluate(calc, "x / 1 + x ^ 1", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 6.0));
+    assert(calc_evaluate(calc, "x ^ 2 + x ^ 3 + x ^ 8 + x ^ 9", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 9.0 + 27.0 + 6561.0 + 19683.0));
+    assert(calc_evaluate(calc, "(x + 1) ^ 2", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 16.0));
+    
+    // Ошибки в константных поддеревьях сообщаются как без оптимизации
+    assert(calc_evaluate(calc, "x + 1 / 0", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "x + (-1)!", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "z + 1 / 0", &result) == CALC_ERROR_UNDEFINED_VAR);
+    assert(calc_evaluate(calc, "1 / 0 + z", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "z * 1", &result) == CALC_ERROR_UNDEFINED_VAR);
+    assert(calc_evaluate(calc, "w ^ 2", &result) == CALC_ERROR_UNDEFINED_VAR);
+    
+    // Упрощение не теряет зависимость от переменной
+    calc_expr_t* expr = calc_compile(calc, "x ^ 2 * 1 + 0");
+    calc_set_variable(calc, "x", 5.0);
+    assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 25.0));
+    calc_expr_free(expr);
+    
+    calc_destroy(calc);
+    printf("Optimized expression tests passed\n");
+}
+
+static void test_parse_memory_reuse(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    static char expression[64 * 1024];
+    static char name[16 * 1024];
+    
+    // Длинное выражение занимает несколько блоков памяти разбора
+    size_t length = 0;
+    for (int i = 0; i < 5000; i++) {
+        length += sprintf(expression + length, "%s(x + %d)", i ? " + " : "", i % 10);
+    }
+    calc_set_variable(calc, "x", 1.0);
+    for (int round = 0; round < 3; round++) {
+        assert(calc_evaluate(calc, expression, &result) == CALC_SUCCESS);
+        assert(double_eq(result, 5000.0 + 500.0 * 45.0));
+        
+        // Короткие выражения после длинного используют ту же память
+        assert(calc_evaluate(calc, "sin(x) ^ 2 + cos(x) ^ 2", &result) == CALC_SUCCESS);
+        assert(double_eq(result, 1.0));
+        assert(calc_evaluate(calc, "(x + 1", &result) == CALC_ERROR_SYNTAX);
+    }
+    
+    // Идентификатор длиннее блока памяти разбора
+    memset(name, 'a', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    assert(calc_set_variable(calc, name, 2.5) == CALC_SUCCESS);
+    assert(calc_evaluate(calc, name, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 2.5));
+    
+    calc_destroy(calc);
+    printf("Parse memory reuse tests passed\n");
+}
+
+static double square(double x) {
+    return x * x;
+}
+
+static double cube(double x) {
+    return x * x * x;
+}
+
+static double logarithm(double base, double x) {
+    return log(x) / log(base);
+}
+
+static void test_registered_functions(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    
+    // Функция без регистрации - ошибка вычисления
+    assert(calc_evaluate(calc, "tan(1)", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "mod(10, 3)", &result) == CALC_ERROR_INVALID_OPERATION);
+    
+    // Выражение, скомпилированное до регистрации, вызывает функцию после нее
+    calc_expr_t* expr = calc_compile(calc, "sq(x) + 1");
+    assert(expr != NULL);
+    calc_set_variable(calc, "x", 3.0);
+    assert(calc_eval_compiled(expr, &result) == CALC_ERROR_INVALID_OPERATION);
+    
+    assert(calc_register_unary_op(calc, "tan", tan) == CALC_SUCCESS);
+    assert(calc_register_unary_op(calc, "sq", square) == CALC_SUCCESS);
+    assert(calc_register_binary_op(calc, "mod", fmod) == CALC_SUCCESS);
+    assert(calc_register_binary_op(calc, "log", logarithm) == CALC_SUCCESS);
+    
+    assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 10.0));
+    
+    assert(calc_evaluate(calc, "tan(1)", &result) == CALC_SUCCESS);
+    assert(double_eq(result, tan(1.0)));
+    assert(calc_evaluate(calc, "mod(10, 3)", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 1.0));
+    assert(calc_evaluate(calc, "log(10, 100) + mod(x * 3, sq(2))", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 3.0));
+    assert(calc_evaluate(calc, "-sq(x + 1) * 2", &result) == CALC_SUCCESS);
+    assert(double_eq(result, -32.0));
+    
+    // Повторная регистрация заменяет функцию и в скомпилированном выражении
+    assert(calc_register_unary_op(calc, "sq", cube) == CALC_SUCCESS);
+    assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 28.0));
+    calc_expr_free(expr);
+    
+    // Пакетное вычисление вызывает зарегистрированные функции
+    expr = calc_compile(calc, "mod(x, 4) + sq(2)");
+    assert(expr != NULL);
+    size_t slot;
+    assert(calc_bind_variable(calc, "x", &slot) == CALC_SUCCESS);
+    double xs[5] = {0.0, 1.0, 5.0, 10.0, 15.0};
+    const double* columns[8] = {NULL};
+    columns[slot] = xs;
+    double out[5];
+    assert(calc_eval_batch(expr, columns, 5, out) == CALC_SUCCESS);
+    for (int i = 0; i < 5; i++) {
+        assert(double_eq(out[i], fmod(xs[i], 4.0) + 8.0));
+    }
+    calc_expr_free(expr);
+    
+    // Встроенные функции не переопределяются, имя должно быть идентификатором
+    assert(calc_register_unary_op(calc, "sin", square) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_register_unary_op(calc, "!", square) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_register_binary_op(calc, "+", fmod) == CALC_ERROR_SYNTAX);
+    assert(calc_register_unary_op(calc, "1x", square) == CALC_ERROR_SYNTAX);
+    assert(calc_register_unary_op(calc, "f", NULL) == CALC_ERROR_SYNTAX);
+    assert(calc_evaluate(calc, "sin(0)", &result) == CALC_SUCCESS);
+    assert(double_eq(result, 0.0));
+    
+    // Неверное число аргументов
+    assert(calc_evaluate(calc, "mod(1)", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "sin(1, 2)", &result) == CALC_ERROR_INVALID_OPERATION);
+    assert(calc_evaluate(calc, "mod(1, )", &result) == CALC_ERROR_SYNTAX);
+    
+    calc_destroy(calc);
+    printf("Registered function tests passed\n");
+}
+
+static void test_environments(void) {
+    calculator_ctx_t* calc = calc_create();
+    double result;
+    size_t x, y;
+    
+    calc_set_variable(calc, "x", 2.0);
+    calc_expr_t* expr = calc_compile(calc, "x * 10 + y");
+    assert(expr != NULL);
+    assert(calc_bind_variable(calc, "y", &y) == CALC_SUCCESS);
+    assert(calc_bind_variable(calc, "x", &x) == CALC_SUCCESS);
+    
+    // Окружение начинается с копии значений контекста
+    calc_env_t* env = calc_env_create(calc);
+    assert(env != NULL);
+    assert(calc_env_get_slot(env, x, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 2.0));
+    assert(calc_eval_env(expr, env, &result) == CALC_ERROR_UNDEFINED_VAR);
+    
+    // Значения окружения и контекста независимы
+    assert(calc_env_set_slot(env, y, 1.0) == CALC_SUCCESS);
+    assert(calc_env_set_slot(env, x, 5.0) == CALC_SUCCESS);
+    assert(calc_eval_env(expr, env, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 51.0));
+    assert(calc_eval_compiled(expr, &result) == CALC_ERROR_UNDEFINED_VAR);
+    calc_set_slot(calc, y, 3.0);
+    assert(calc_eval_compiled(expr, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 23.0));
+    assert(calc_eval_env(expr, env, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 51.0));
+    
+    // Несколько окружений вычисляют одно выражение с разными значениями
+    calc_env_t* other = calc_env_create(calc);
+    assert(other != NULL);
+    assert(calc_eval_env(expr, other, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 23.0));
+    assert(calc_env_set_slot(other, x, -1.0) == CALC_SUCCESS);
+    assert(calc_eval_env(expr, other, &result) == CALC_SUCCESS);
+    assert(double_eq(result, -7.0));
+    assert(calc_eval_env(expr, env, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 51.0));
+    
+    // Ячейка, созданная после окружения, в нем не имеет значения, пока его не задать
+    calc_expr_t* later = calc_compile(calc, "x + z");
+    assert(later != NULL);
+    size_t z;
+    assert(calc_bind_variable(calc, "z", &z) == CALC_SUCCESS);
+    calc_set_slot(calc, z, 100.0);
+    assert(calc_eval_env(later, env, &result) == CALC_ERROR_UNDEFINED_VAR);
+    assert(calc_env_get_slot(env, z, &result) == CALC_ERROR_UNDEFINED_VAR);
+    assert(calc_env_set_slot(env, z, 0.5) == CALC_SUCCESS);
+    assert(calc_eval_env(later, env, &result) == CALC_SUCCESS);
+    assert(double_eq(result, 5.5));
+    assert(calc_env_set_slot(env, z + 1, 0.0) == CALC_ERROR_UNDEFINED_VAR);
+    
+    // Пакетное вычисление берет переменные без столбцов из окружения
+    double xs[3] = {1.0, 2.0, 3.0};
+    const double* columns[3] = {NULL};
+    columns[x] = xs;
+    double out[3];
+    assert(calc_eval_batch_env(expr, env, columns, 3, out) == CALC_SUCCESS);
+    for (int i = 0; i < 3; i++) {
+        assert(double_eq(out[i], xs[i] * 10 + 1.0));
+    }
+    
+    // Окружение другого контекста не подходит
+    calculator_ctx_t* foreign = calc_create();
+    calc_env_t* foreign_env = calc_env_create(foreign);
+    assert(foreign_env != NULL);
+    assert(calc_eval_env(expr, foreign_env, &result) == CALC_ERROR_SYNTAX);
+    assert(calc_eval_env(expr, NULL, &result) == CALC_ERROR_SYNTAX);
+    calc_env_destroy(foreign_env);
+    calc_destroy(foreign);
+    
+    calc_env_destroy(other);
+    calc_env_destroy(env);
+    calc_expr_free(later);
+    calc_expr_free(expr);
+    calc_destroy(calc);
+    printf("Environment tests passed\n");
+}
+
 int main(void) {
     printf("Running calculator tests...\n\n");
     
@@ -137,6 +547,14 @@ int main(void) {
     test_unary_operations();
     test_error_handling();
     test_complex_expressions();
+    test_compiled_expressions();
+    test_deep_expressions();
+    test_variable_slots();
+    test_batch_evaluation();
+    test_optimized_expressions();
+    test_parse_memory_reuse();
+    test_registered_functions();
+    test_environments();
     
     printf("\nAll tests passed successfully!\n");
     return 0;
@@ -6,13 +6,22 @@
  * передает их в модуль ядра через интерфейс /proc/process_info и выводит
  * полученную информацию: UID пользователя, путь к исполняемому файлу и
  * командную строку запуска для каждого указанного процесса.
+ *
+ * В режиме --bench приложение измеряет число запросов в секунду через
+ * двоичный интерфейс (ioctl), через текстовый интерфейс и, для сравнения,
+ * через запуск дочернего процесса, читающего /proc/<pid>/cmdline.
  */
 
  #include <stdio.h>    /* Для функций ввода-вывода (printf, fprintf) */
  #include <stdlib.h>   /* Для функций работы с памятью и конвертации (atoi) */
  #include <string.h>   /* Для функций работы со строками (strlen) */
+ #include <stdint.h>   /* Для uintptr_t */
  #include <unistd.h>   /* Для функций POSIX API (read, write, close) */
  #include <fcntl.h>    /* Для функций работы с файловыми дескрипторами (open) */
+ #include <time.h>     /* Для clock_gettime */
+ #include <sys/ioctl.h> /* Для ioctl */
+ #include <sys/wait.h> /* Для waitpid */
+ #include "process_info_ioctl.h" /* Двоичный интерфейс модуля */
  
  /* Путь к файлу /proc, созданному модулем ядра */
  #define PROC_PATH "/proc/process_info"
@@ -20,17 +29,24 @@
  /* Максимальный размер буфера для чтения данных из /proc */
  #define BUFFER_SIZE 4096
  
+ /* Число повторов запроса в режиме --bench по умолчанию */
+ #define BENCH_ITERATIONS 10000
+ 
+ /* Запуск дочернего процесса на порядки медленнее, поэтому он повторяется реже */
+ #define BENCH_FORK_DIVISOR 20
+ 
  /**
-  * @brief Получение информации о процессе через модуль ядра
+  * @brief Получение информации о процессах через модуль ядра
   *
-  * Функция открывает файл /proc/process_info, записывает в него PID,
-  * считывает и выводит полученную информацию от модуля ядра.
+  * Функция открывает файл /proc/process_info, записывает в него весь запрос
+  * одной записью, считывает и выводит полученную информацию от модуля ядра.
+  * Модуль находит все процессы запроса за один проход, поэтому число
+  * системных вызовов не зависит от числа PID.
   *
-  * @param pid Идентификатор процесса для запроса
+  * @param request Запрос: PID, разделенные пробелами, или "all"
   */
- void get_process_info(int pid) {
+ void get_processes_info(const char *request) {
      int fd;                   /* Файловый дескриптор для /proc/process_info */
-     char pid_str[16];         /* Буфер для преобразования PID в строку */
      char buffer[BUFFER_SIZE]; /* Буфер для чтения данных из /proc */
      ssize_t bytes_read;       /* Количество прочитанных байт */
      
@@ -43,11 +59,10 @@
          exit(EXIT_FAILURE);
      }
      
-     /* Преобразуем PID в строку и записываем в /proc */
-     sprintf(pid_str, "%d", pid);
-     if (write(fd, pid_str, strlen(pid_str)) < 0) {
+     /* Записываем запрос в /proc */
+     if (write(fd, request, strlen(request)) < 0) {
          /* Обрабатываем ошибку записи в файл */
-         perror("Ошибка при записи PID в /proc/process_info");
+         perror("Ошибка при записи запроса в /proc/process_info");
          close(fd);
          exit(EXIT_FAILURE);
      }
@@ -55,8 +70,10 @@
      /* Сбрасываем указатель файла на начало для последующего чтения */
      lseek(fd, 0, SEEK_SET);
      
-     /* Читаем информацию о процессе из /proc */
-     bytes_read = read(fd, buffer, BUFFER_SIZE - 1);
+     /* Читаем информацию о процессах из /proc до конца файла: записей может быть много */
+     while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0) {
+         fwrite(buffer, 1, (size_t)bytes_read, stdout);
+     }
      if (bytes_read < 0) {
          /* Обрабатываем ошибку чтения из файла */
          perror("Ошибка при чтении из /proc/process_info");
@@ -64,37 +81,261 @@
          exit(EXIT_FAILURE);
      }
      
-     /* Добавляем нулевой символ в конец буфера для корректного вывода */
-     buffer[bytes_read] = '\0';
+     /* Закрываем файловый дескриптор */
+     close(fd);
+ }
+ 
+ /**
+  * @brief Текущее время в секундах по монотонным часам
+  */
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+ }
+ 
+ /**
+  * @brief Открытие /proc/process_info с сообщением об ошибке
+  *
+  * @return Файловый дескриптор
+  */
+ static int open_proc(void) {
+     int fd = open(PROC_PATH, O_RDWR);
+     if (fd < 0) {
+         perror("Ошибка при открытии /proc/process_info");
+         fprintf(stderr, "Убедитесь, что модуль ядра загружен командой 'sudo insmod process_info.ko'\n");
+         exit(EXIT_FAILURE);
+     }
+     return fd;
+ }
+ 
+ /**
+  * @brief Замер двоичного интерфейса: один ioctl на все PID за повтор
+  *
+  * @return Время в секундах или отрицательное значение при ошибке
+  */
+ static double bench_ioctl(const int *pids, int count, int iterations) {
+     struct process_info_record *records;
+     struct process_info_query query;
+     double start, elapsed;
+     int fd = open_proc();
+     int i;
+     
+     records = calloc((size_t)count, sizeof(*records));
+     if (!records) {
+         close(fd);
+         return -1.0;
+     }
+     query.pids = (__u64)(uintptr_t)pids;
+     query.records = (__u64)(uintptr_t)records;
+     query.count = (__u32)count;
+     
+     start = now_seconds();
+     for (i = 0; i < iterations; i++) {
+         query.filled = 0;
+         if (ioctl(fd, PROCESS_INFO_IOC_QUERY, &query) < 0 || query.filled != (__u32)count) {
+             perror("Ошибка ioctl PROCESS_INFO_IOC_QUERY");
+             free(records);
+             close(fd);
+             return -1.0;
+         }
+     }
+     elapsed = now_seconds() - start;
      
-     /* Выводим полученную информацию */
-     printf("Информация о процессе %d:\n", pid);
-     printf("%s\n", buffer);
+     free(records);
+     close(fd);
+     return elapsed;
+ }
+ 
+ /**
+  * @brief Замер текстового интерфейса: запись запроса и чтение всего вывода за повтор
+  *
+  * @return Время в секундах или отрицательное значение при ошибке
+  */
+ static double bench_text(const char *request, int iterations) {
+     char buffer[BUFFER_SIZE];
+     double start, elapsed;
+     size_t length = strlen(request);
+     int fd = open_proc();
+     int i;
+     
+     start = now_seconds();
+     for (i = 0; i < iterations; i++) {
+         if (write(fd, request, length) < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+             perror("Ошибка запроса к /proc/process_info");
+             close(fd);
+             return -1.0;
+         }
+         while (read(fd, buffer, sizeof(buffer)) > 0) {
+         }
+     }
+     elapsed = now_seconds() - start;
      
-     /* Закрываем файловый дескриптор */
      close(fd);
+     return elapsed;
+ }
+ 
+ /**
+  * @brief Замер запуска дочернего процесса, читающего /proc/<pid>/cmdline, для каждого PID
+  *
+  * @return Время в секундах или отрицательное значение при ошибке
+  */
+ static double bench_fork(const int *pids, int count, int iterations) {
+     double start = now_seconds();
+     int i, j;
+     
+     for (i = 0; i < iterations; i++) {
+         for (j = 0; j < count; j++) {
+             pid_t child = fork();
+             if (child < 0) {
+                 perror("Ошибка fork");
+                 return -1.0;
+             }
+             if (child == 0) {
+                 char path[64];
+                 char buffer[BUFFER_SIZE];
+                 int fd;
+                 
+                 snprintf(path, sizeof(path), "/proc/%d/cmdline", pids[j]);
+                 fd = open(path, O_RDONLY);
+                 if (fd >= 0) {
+                     while (read(fd, buffer, sizeof(buffer)) > 0) {
+                     }
+                     close(fd);
+                 }
+                 _exit(0);
+             }
+             waitpid(child, NULL, 0);
+         }
+     }
+     return now_seconds() - start;
+ }
+ 
+ /**
+  * @brief Вывод результата замера
+  */
+ static void print_rate(const char *name, double elapsed, int iterations, int count) {
+     double queries = (double)iterations * count;
+     
+     if (elapsed < 0) {
+         printf("%-32s ошибка\n", name);
+     } else {
+         printf("%-32s %12.0f запросов/с  (%.2f мкс на PID)\n",
+                name, queries / elapsed, elapsed / queries * 1e6);
+     }
+ }
+ 
+ /**
+  * @brief Режим --bench: сравнение способов получения информации о процессах
+  *
+  * Запрос - информация об одном PID; все PID повтора передаются модулю
+  * одним ioctl или одной записью.
+  *
+  * @param pids PID для запросов
+  * @param count Число PID
+  * @param iterations Число повторов
+  * @return Код завершения программы
+  */
+ static int run_benchmark(const int *pids, int count, int iterations) {
+     char *request;
+     size_t length = 0;
+     int fork_iterations = iterations / BENCH_FORK_DIVISOR > 0 ? iterations / BENCH_FORK_DIVISOR : 1;
+     double ioctl_time, text_time, fork_time;
+     int i;
+     
+     request = malloc((size_t)count * 12 + 1);
+     if (!request) {
+         perror("Ошибка выделения памяти");
+         return EXIT_FAILURE;
+     }
+     for (i = 0; i < count; i++) {
+         length += (size_t)sprintf(request + length, "%s%d", length ? " " : "", pids[i]);
+     }
+     
+     printf("PID в запросе: %d, повторов: %d (fork: %d)\n\n", count, iterations, fork_iterations);
+     
+     ioctl_time = bench_ioctl(pids, count, iterations);
+     text_time = bench_text(request, iterations);
+     fork_time = bench_fork(pids, count, fork_iterations);
+     
+     print_rate("ioctl PROCESS_INFO_IOC_QUERY", ioctl_time, iterations, count);
+     print_rate("текстовый запрос", text_time, iterations, count);
+     print_rate("fork + чтение /proc/<pid>/cmdline", fork_time, fork_iterations, count);
+     if (ioctl_time > 0 && fork_time > 0) {
+         printf("\nУскорение ioctl относительно fork: %.1fx\n",
+                (fork_time / fork_iterations) / (ioctl_time / iterations));
+     }
+     
+     free(request);
+     return ioctl_time < 0 || text_time < 0 || fork_time < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
  }
  
  /**
   * @brief Главная функция программы
   *
   * Проверяет количество и корректность аргументов командной строки,
-  * для каждого указанного PID вызывает функцию получения информации.
+  * собирает все PID в один запрос и передает его модулю ядра.
   *
   * @param argc Количество аргументов командной строки
   * @param argv Массив аргументов командной строки
   * @return Код завершения программы
   */
  int main(int argc, char *argv[]) {
+     char *request;        /* Запрос к модулю: PID через пробел */
+     size_t length = 0;    /* Длина запроса */
      int i;
      
      /* Проверяем, что был передан хотя бы один PID */
      if (argc < 2) {
          fprintf(stderr, "Использование: %s <pid1> [pid2] [pid3] ...\n", argv[0]);
+         fprintf(stderr, "               %s all\n", argv[0]);
+         fprintf(stderr, "               %s --bench [повторов] [pid1] [pid2] ...\n", argv[0]);
          return EXIT_FAILURE;
      }
      
-     /* Обрабатываем каждый переданный PID */
+     /* Режим замера: по умолчанию запрашивается сам процесс приложения */
+     if (strcmp(argv[1], "--bench") == 0) {
+         int iterations = argc > 2 ? atoi(argv[2]) : BENCH_ITERATIONS;
+         int count = argc > 3 ? argc - 3 : 1;
+         int *pids = malloc((size_t)count * sizeof(int));
+         int status;
+         
+         if (!pids) {
+             perror("Ошибка выделения памяти");
+             return EXIT_FAILURE;
+         }
+         if (iterations <= 0) {
+             iterations = BENCH_ITERATIONS;
+         }
+         pids[0] = (int)getpid();
+         for (i = 3; i < argc; i++) {
+             pids[i - 3] = atoi(argv[i]);
+             if (pids[i - 3] <= 0) {
+                 fprintf(stderr, "Неверный PID: %s\n", argv[i]);
+                 free(pids);
+                 return EXIT_FAILURE;
+             }
+         }
+         
+         status = run_benchmark(pids, count, iterations);
+         free(pids);
+         return status;
+     }
+     
+     /* Запрос всех процессов передается модулю как есть */
+     if (argc == 2 && strcmp(argv[1], "all") == 0) {
+         get_processes_info("all");
+         return EXIT_SUCCESS;
+     }
+     
+     /* Каждый PID занимает не больше 11 символов и разделитель */
+     request = malloc((size_t)(argc - 1) * 12 + 1);
+     if (!request) {
+         perror("Ошибка выделения памяти");
+         return EXIT_FAILURE;
+     }
+     
+     /* Собираем корректные PID в один запрос */
      for (i = 1; i < argc; i++) {
          /* Преобразуем строку в число */
          int pid = atoi(argv[i]);
@@ -105,14 +346,14 @@
              continue;
          }
          
-         /* Получаем и выводим информацию о процессе */
-         get_process_info(pid);
-         
-         /* Добавляем разделитель между информацией о разных процессах */
-         if (i < argc - 1) {
-             printf("----------------------------------\n");
-         }
+         length += (size_t)sprintf(request + length, "%s%d", length ? " " : "", pid);
      }
      
+     /* Получаем и выводим информацию обо всех процессах одним запросом */
+     if (length > 0) {
+         get_processes_info(request);
+     }
+     
+     free(request);
      return EXIT_SUCCESS;
- }
\ No newline at end of file
+ }
@@ -5,6 +5,15 @@
  * Данный модуль создает интерфейс в /proc для получения информации
  * о процессах по их идентификатору (PID). Модуль возвращает UID пользователя,
  * путь к исполняемому файлу и командную строку запуска процесса.
+ *
+ * В файл записывается запрос: один или несколько PID, разделенных пробелами,
+ * переводами строк или запятыми, либо слово "all" для всех процессов.
+ * Чтение возвращает по одной записи на каждый PID запроса, записи разделены
+ * пустой строкой. Запрос хранится отдельно для каждого открытого файла.
+ *
+ * Для частых опросов есть двоичный интерфейс (process_info_ioctl.h): ioctl
+ * PROCESS_INFO_IOC_QUERY заполняет массив записей фиксированного размера
+ * прямо в буфере приложения.
  */
 
  #include <linux/module.h>      /* Необходимо для всех модулей */
@@ -13,12 +22,14 @@
  #include <linux/seq_file.h>    /* Для упрощения работы с /proc интерфейсом */
  #include <linux/sched.h>       /* Для работы с задачами (task_struct) */
  #include <linux/sched/task.h>  /* Для работы с API задач */
+ #include <linux/sched/signal.h> /* Для for_each_process */
  #include <linux/uaccess.h>     /* Для copy_from_user */
  #include <linux/slab.h>        /* Для kmalloc и kfree */
  #include <linux/mm.h>          /* Для работы с mm_struct */
  #include <linux/fs_struct.h>   /* Для работы с файловой структурой процесса */
  #include <linux/version.h>     /* Для проверки версии ядра */
  #include <linux/binfmts.h>     /* Для доступа к данным запуска процесса */
+ #include "process_info_ioctl.h" /* Двоичный интерфейс модуля */
  
  MODULE_LICENSE("GPL");         /* Лицензия модуля - GNU GPL */
  MODULE_AUTHOR("Your Name");    /* Автор модуля */
@@ -27,183 +38,509 @@
  
  #define PROCFS_NAME "process_info"  /* Имя файла в /proc */
  
+ #define PROCESS_INFO_MAX_WRITE (64 * 1024) /* Наибольший размер запроса в байтах */
+ #define PROCESS_INFO_MIN_TASKS 256         /* Начальная емкость массива задач для запроса "all" */
+ #define PROCESS_INFO_SEPARATORS " \t\n,"  /* Разделители PID в запросе */
+ #define PROCESS_INFO_CHUNK 32              /* Число записей, обрабатываемых ioctl за один проход под RCU */
+ 
  /* Глобальные переменные модуля */
  static struct proc_dir_entry *proc_file;  /* Указатель на файл в /proc */
- static pid_t requested_pid = -1;          /* Запрошенный PID для обработки */
  
  /**
-  * @brief Чтение командной строки процесса альтернативным способом
+  * @brief Процесс, найденный при проходе под RCU
+  *
+  * Ссылка на задачу удерживается до конца формирования вывода, поэтому
+  * данные, для получения которых нужно засыпать, читаются уже вне RCU.
+  */
+ struct process_info_entry {
+     pid_t pid;                 /* PID процесса */
+     struct task_struct *task;  /* Задача или NULL, если процесс не найден */
+     int uid;                   /* UID пользователя процесса */
+ };
+ 
+ /**
+  * @brief Запрос, записанный в открытый файл
+  *
+  * Хранится в seq_file->private и освобождается при закрытии файла,
+  * поэтому процессы, одновременно работающие с /proc/process_info,
+  * не мешают друг другу. Доступ защищен мьютексом seq_file.
+  *
+  * Буферы выделяются при первом чтении или ioctl и служат до закрытия файла,
+  * поэтому повторные запросы не обращаются к распределителю памяти.
+  */
+ struct process_info_request {
+     pid_t *pids;   /* Запрошенные PID */
+     size_t count;  /* Число запрошенных PID */
+     bool all;      /* Запрошены все процессы */
+     
+     struct process_info_entry *entries;  /* Процессы, найденные для текущего прохода чтения */
+     size_t num_entries;                  /* Число найденных процессов */
+     bool walked;                         /* Вывод прошел дальше первой записи */
+     
+     char *exec_path;  /* Буфер размером PATH_MAX для d_path */
+     char *cmdline;    /* Буфер размером PAGE_SIZE для командной строки текстового вывода */
+     
+     pid_t *chunk_pids;                          /* PID очередной части ioctl-запроса */
+     struct process_info_entry *chunk_entries;   /* Найденные процессы части */
+     struct process_info_record *chunk_records;  /* Записи части для копирования приложению */
+ };
+ 
+ /**
+  * @brief Чтение командной строки процесса
   *
-  * Эта функция получает командную строку процесса путем чтения из /proc/<pid>/cmdline
-  * вместо использования недоступной функции get_cmdline
+  * Копирует аргументы запуска из памяти процесса функцией access_process_vm
+  * без FOLL_FORCE, поэтому защита страниц не обходится, а FOLL_ANON
+  * ограничивает чтение анонимной памятью, как у /proc/<pid>/cmdline.
+  * Аргументы разделены нулевыми байтами.
   *
   * @param task Указатель на структуру задачи
+  * @param mm Структура памяти процесса (ссылка удерживается вызывающим)
   * @param buffer Буфер для хранения командной строки
   * @param buf_size Размер буфера
+  * @param truncated Указатель для признака того, что строка не поместилась в буфер
   * @return Количество записанных байт или отрицательное значение при ошибке
   */
- static int read_cmdline(struct task_struct *task, char *buffer, int buf_size)
+ static int read_cmdline(struct task_struct *task, struct mm_struct *mm, char *buffer,
+                         int buf_size, bool *truncated)
  {
-     struct mm_struct *mm;
-     int ret = 0;
+     unsigned long arg_start, arg_end, len;
      
-     if (!buffer || !task)
+     *truncated = false;
+     if (!buffer || !task || !mm || buf_size <= 0)
          return -EINVAL;
      
-     /* Получаем структуру mm */
-     mm = get_task_mm(task);
-     if (!mm)
-         return -ENOENT;
-         
-     /* Используем формированный вручную вывод, включающий имя программы и аргументы */
-     if (mm->arg_end > mm->arg_start) {
-         int len = mm->arg_end - mm->arg_start;
-         if (len > buf_size - 1)
-             len = buf_size - 1;
-             
-         /* Здесь мы могли бы скопировать данные из памяти пользователя,
-            но это сложнее сделать напрямую. Вместо этого напишем строку с соответствующей информацией */
-         snprintf(buffer, buf_size, "[командная строка длиной %d байт]", len);
-         ret = strlen(buffer);
-     } else {
-         strscpy(buffer, "[нет данных о командной строке]", buf_size);
-         ret = strlen(buffer);
+     /* Границы области аргументов защищены arg_lock */
+     spin_lock(&mm->arg_lock);
+     arg_start = mm->arg_start;
+     arg_end = mm->arg_end;
+     spin_unlock(&mm->arg_lock);
+     
+     if (arg_end <= arg_start)
+         return 0;
+     
+     len = arg_end - arg_start;
+     if (len > (unsigned long)buf_size) {
+         len = buf_size;
+         *truncated = true;
      }
      
-     mmput(mm);
-     return ret;
+     return access_process_vm(task, arg_start, buffer, len, FOLL_ANON);
  }
  
  /**
-  * @brief Функция отображения информации о процессе в /proc
+  * @brief Получение пути к исполняемому файлу процесса
   *
-  * Эта функция вызывается при чтении файла /proc/process_info.
-  * Она находит процесс с запрошенным PID и собирает информацию о нем:
-  * - UID пользователя
-  * - Путь к исполняемому файлу
-  * - Командную строку запуска
-  *
-  * @param m Указатель на seq_file для записи данных
-  * @param v Неиспользуемый параметр (требуется сигнатурой)
-  * @return 0 при успешном выполнении
+  * @param mm Структура памяти процесса
+  * @param buffer Буфер размером PATH_MAX
+  * @return Указатель на путь внутри buffer или NULL, если путь неизвестен
   */
- static int process_info_show(struct seq_file *m, void *v)
+ static const char *read_exec_path(struct mm_struct *mm, char *buffer)
  {
-     struct task_struct *task;  /* Указатель на структуру задачи */
-     struct mm_struct *mm;      /* Указатель на структуру памяти процесса */
-     char *buffer;              /* Буфер для считывания данных */
-     char *exec_path = NULL;    /* Путь к исполняемому файлу */
-     char *cmdline = NULL;      /* Командная строка */
-     int uid = -1;              /* UID пользователя процесса */
-     int arg_len;
+     const char *path = NULL;
      
-     /* Проверяем, был ли установлен корректный PID */
-     if (requested_pid <= 0) {
-         seq_printf(m, "No valid PID provided\n");
-         return 0;
+     /* Блокируем mmap_lock для безопасного доступа к mm */
+     down_read(&mm->mmap_lock);
+     
+     /* Получаем путь к исполняемому файлу */
+     if (mm->exe_file) {
+         char *tmp = d_path(&mm->exe_file->f_path, buffer, PATH_MAX);
+         if (!IS_ERR(tmp))
+             path = tmp;
      }
      
-     /* Блокируем RCU перед доступом к структурам ядра */
-     rcu_read_lock();
+     /* Разблокируем mmap_lock */
+     up_read(&mm->mmap_lock);
+     return path;
+ }
+ 
+ /**
+  * @brief Заполнение записи о найденном процессе
+  *
+  * Вызывается под rcu_read_lock: увеличивает счетчик ссылок задачи
+  * и читает UID, для доступа к которому нужна защита RCU.
+  *
+  * @param entry Заполняемая запись
+  * @param pid PID процесса
+  * @param task Задача или NULL, если процесс не найден
+  */
+ static void fill_entry(struct process_info_entry *entry, pid_t pid, struct task_struct *task)
+ {
+     entry->pid = pid;
+     entry->task = task;
+     entry->uid = -1;
+     if (task) {
+         get_task_struct(task);
+         entry->uid = from_kuid_munged(current_user_ns(), task_uid(task));
+     }
+ }
+ 
+ /**
+  * @brief Освобождение ссылок на задачи из массива записей
+  *
+  * @param entries Массив записей
+  * @param count Число записей
+  */
+ static void release_entries(struct process_info_entry *entries, size_t count)
+ {
+     size_t i;
      
-     /* Находим task_struct по PID */
-     task = pid_task(find_vpid(requested_pid), PIDTYPE_PID);
+     for (i = 0; i < count; i++) {
+         if (entries[i].task)
+             put_task_struct(entries[i].task);
+     }
+ }
+ 
+ /**
+  * @brief Поиск всех процессов запроса за один проход под RCU
+  *
+  * Для запроса "all" число процессов заранее неизвестно: если массив
+  * оказался мал, ссылки освобождаются и проход повторяется с массивом,
+  * рассчитанным на найденное число процессов.
+  *
+  * @param request Запрос открытого файла
+  * @param count Указатель для записи числа найденных записей
+  * @return Массив записей (освобождается kvfree) или ERR_PTR при ошибке
+  */
+ static struct process_info_entry *collect_entries(const struct process_info_request *request,
+                                                   size_t *count)
+ {
+     size_t capacity = request->all ? PROCESS_INFO_MIN_TASKS : request->count;
      
-     /* Проверяем, найден ли процесс */
-     if (!task) {
+     for (;;) {
+         struct process_info_entry *entries;
+         struct task_struct *task;
+         size_t found = 0;
+         size_t i;
+         
+         entries = kvmalloc_array(capacity, sizeof(*entries), GFP_KERNEL);
+         if (!entries)
+             return ERR_PTR(-ENOMEM);
+         
+         /* Блокируем RCU один раз на весь запрос */
+         rcu_read_lock();
+         if (request->all) {
+             for_each_process(task) {
+                 pid_t pid = task_pid_vnr(task);
+                 
+                 /* Процессы вне пространства имен PID читающего не видны */
+                 if (pid <= 0)
+                     continue;
+                 if (found < capacity)
+                     fill_entry(&entries[found], pid, task);
+                 found++;
+             }
+         } else {
+             for (i = 0; i < request->count; i++) {
+                 task = pid_task(find_vpid(request->pids[i]), PIDTYPE_PID);
+                 fill_entry(&entries[found++], request->pids[i], task);
+             }
+         }
          rcu_read_unlock();
-         seq_printf(m, "Process with PID %d not found\n", requested_pid);
-         return 0;
+         
+         if (found <= capacity) {
+             *count = found;
+             return entries;
+         }
+         
+         /* Процессов больше, чем мест в массиве: повторяем с запасом на новые */
+         release_entries(entries, capacity);
+         kvfree(entries);
+         capacity = found + found / 4;
      }
+ }
+ 
+ /**
+  * @brief Вывод записи об одном процессе
+  *
+  * Вызывается вне RCU: получение mm, d_path и чтение командной строки
+  * могут засыпать. Используются буферы открытого файла.
+  *
+  * @param m Указатель на seq_file для записи данных
+  * @param entry Запись о процессе
+  * @param request Запрос открытого файла с выделенными буферами
+  */
+ static void show_entry(struct seq_file *m, const struct process_info_entry *entry,
+                        struct process_info_request *request)
+ {
+     struct mm_struct *mm;        /* Указатель на структуру памяти процесса */
+     const char *path = NULL;
+     bool truncated;
+     int arg_len = -1;
+     int i;
      
-     /* Получаем UID пользователя процесса */
-     uid = from_kuid_munged(current_user_ns(), task_uid(task));
+     /* Проверяем, найден ли процесс */
+     if (!entry->task) {
+         seq_printf(m, "Process with PID %d not found\n", entry->pid);
+         return;
+     }
      
      /* Получаем информацию о пути к исполняемому файлу и командной строке */
-     mm = get_task_mm(task);  /* Получаем структуру памяти процесса */
+     mm = get_task_mm(entry->task);
      if (mm) {
-         /* Выделяем память для пути к исполняемому файлу */
-         exec_path = kmalloc(PATH_MAX, GFP_KERNEL);
-         if (exec_path) {
-             /* Блокируем mmap_lock для безопасного доступа к mm */
-             down_read(&mm->mmap_lock);
-             
-             /* Получаем путь к исполняемому файлу */
-             if (mm->exe_file) {
-                 char *tmp = d_path(&mm->exe_file->f_path, exec_path, PATH_MAX);
-                 if (!IS_ERR(tmp)) {
-                     /* Перемещаем путь в начало буфера */
-                     memmove(exec_path, tmp, strlen(tmp) + 1);
-                 } else {
-                     strcpy(exec_path, "Unknown");
-                 }
-             } else {
-                 strcpy(exec_path, "Unknown");
-             }
-             
-             /* Разблокируем mmap_lock */
-             up_read(&mm->mmap_lock);
-         }
-         
-         /* Выделяем память для буфера командной строки */
-         buffer = kmalloc(PAGE_SIZE, GFP_KERNEL);
-         if (buffer) {
-             cmdline = kmalloc(PAGE_SIZE, GFP_KERNEL);
-             if (cmdline) {
-                 /* Получаем командную строку процесса альтернативным способом */
-                 arg_len = read_cmdline(task, buffer, PAGE_SIZE - 1);
-                 buffer[arg_len > 0 ? arg_len : 0] = '\0';
-                 
-                 /* Копируем командную строку в результирующий буфер */
-                 strncpy(cmdline, buffer, PAGE_SIZE - 1);
-                 cmdline[PAGE_SIZE - 1] = '\0';
-             }
-             kfree(buffer);  /* Освобождаем временный буфер */
-         }
+         path = read_exec_path(mm, request->exec_path);
+         arg_len = read_cmdline(entry->task, mm, request->cmdline, PAGE_SIZE - 1, &truncated);
          
          /* Уменьшаем счетчик ссылок на mm_struct */
          mmput(mm);
      }
      
+     /* В текстовом выводе аргументы разделяются пробелами, как в ps */
+     if (arg_len > 0) {
+         while (arg_len > 0 && request->cmdline[arg_len - 1] == '\0')
+             arg_len--;
+         for (i = 0; i < arg_len; i++) {
+             if (request->cmdline[i] == '\0')
+                 request->cmdline[i] = ' ';
+         }
+     }
+     
      /* Выводим собранную информацию */
-     seq_printf(m, "PID: %d\n", requested_pid);
-     seq_printf(m, "UID: %d\n", uid);
-     seq_printf(m, "Executable: %s\n", exec_path ? exec_path : "Unknown");
-     seq_printf(m, "Command line: %s\n", cmdline ? cmdline : "Unknown");
-     
-     /* Освобождаем выделенную память */
-     if (exec_path) {
-         kfree(exec_path);
+     seq_printf(m, "PID: %d\n", entry->pid);
+     seq_printf(m, "UID: %d\n", entry->uid);
+     seq_printf(m, "Executable: %s\n", path ? path : "Unknown");
+     if (arg_len >= 0)
+         seq_printf(m, "Command line: %.*s\n", arg_len, request->cmdline);
+     else
+         seq_printf(m, "Command line: Unknown\n");
+ }
+ 
+ /**
+  * @brief Освобождение процессов, найденных для прохода чтения
+  *
+  * @param request Запрос открытого файла
+  */
+ static void drop_entries(struct process_info_request *request)
+ {
+     if (request->entries) {
+         release_entries(request->entries, request->num_entries);
+         kvfree(request->entries);
      }
-     if (cmdline) {
-         kfree(cmdline);
+     request->entries = NULL;
+     request->num_entries = 0;
+     request->walked = false;
+ }
+ 
+ /**
+  * @brief Начало или продолжение прохода чтения /proc/process_info
+  *
+  * Процессы запроса находятся один раз, при чтении с начала файла, за один
+  * проход под RCU и хранятся в запросе до конца вывода. Каждая запись выводится
+  * отдельным вызовом show, поэтому, когда seq_read увеличивает буфер и повторяет
+  * вызов, заново формируется только текущая запись, а не весь вывод.
+  * Повтор с начала до перехода ко второй записи использует уже найденные процессы.
+  *
+  * @param m Указатель на seq_file
+  * @param pos Номер записи
+  * @return Запись, SEQ_START_TOKEN для пустого запроса, NULL в конце или ERR_PTR
+  */
+ static void *process_info_start(struct seq_file *m, loff_t *pos)
+ {
+     struct process_info_request *request = m->private;
+     struct process_info_entry *entries;
+     size_t count;
+     
+     /* Запрос не записан: выводим одно сообщение */
+     if (!request->all && request->count == 0)
+         return *pos == 0 ? SEQ_START_TOKEN : NULL;
+     
+     if (*pos == 0 && (!request->entries || request->walked)) {
+         /* Буферы открытого файла выделяются один раз */
+         if (!request->exec_path)
+             request->exec_path = kmalloc(PATH_MAX, GFP_KERNEL);
+         if (!request->cmdline)
+             request->cmdline = kmalloc(PAGE_SIZE, GFP_KERNEL);
+         if (!request->exec_path || !request->cmdline)
+             return ERR_PTR(-ENOMEM);
+         
+         drop_entries(request);
+         entries = collect_entries(request, &count);
+         if (IS_ERR(entries))
+             return entries;
+         request->entries = entries;
+         request->num_entries = count;
      }
      
-     /* Разблокируем RCU */
-     rcu_read_unlock();
+     /* Вывод закончен: ссылки на задачи больше не нужны */
+     if (!request->entries || *pos >= (loff_t)request->num_entries) {
+         drop_entries(request);
+         return NULL;
+     }
+     return &request->entries[*pos];
+ }
+ 
+ /**
+  * @brief Переход к следующей записи
+  *
+  * @param m Указатель на seq_file
+  * @param v Текущая запись
+  * @param pos Номер записи
+  * @return Следующая запись или NULL в конце
+  */
+ static void *process_info_next(struct seq_file *m, void *v, loff_t *pos)
+ {
+     struct process_info_request *request = m->private;
+     
+     ++*pos;
+     request->walked = true;
+     if (v == SEQ_START_TOKEN || *pos >= (loff_t)request->num_entries)
+         return NULL;
+     return &request->entries[*pos];
+ }
+ 
+ /**
+  * @brief Завершение части прохода чтения
+  *
+  * Найденные процессы остаются в запросе до следующей части прохода.
+  *
+  * @param m Указатель на seq_file
+  * @param v Текущая запись
+  */
+ static void process_info_stop(struct seq_file *m, void *v)
+ {
+ }
+ 
+ /**
+  * @brief Функция отображения информации о процессе в /proc
+  *
+  * Эта функция вызывается при чтении файла /proc/process_info для каждой
+  * записи прохода и выводит:
+  * - UID пользователя
+  * - Путь к исполняемому файлу
+  * - Командную строку запуска
+  *
+  * @param m Указатель на seq_file для записи данных
+  * @param v Запись о процессе или SEQ_START_TOKEN для пустого запроса
+  * @return 0 при успешном выполнении
+  */
+ static int process_info_show(struct seq_file *m, void *v)
+ {
+     struct process_info_request *request = m->private;
+     const struct process_info_entry *entry = v;
+     
+     /* Проверяем, был ли записан запрос */
+     if (v == SEQ_START_TOKEN) {
+         seq_printf(m, "No valid PID provided\n");
+         return 0;
+     }
+     
+     /* Записи разделены пустой строкой */
+     if (entry != request->entries)
+         seq_putc(m, '\n');
+     show_entry(m, entry, request);
      return 0;
  }
  
+ static const struct seq_operations process_info_seq_ops = {
+     .start = process_info_start,  /* Начало прохода: поиск процессов под RCU */
+     .next = process_info_next,    /* Следующая запись */
+     .stop = process_info_stop,    /* Конец части прохода */
+     .show = process_info_show,    /* Вывод одной записи */
+ };
+ 
  /**
   * @brief Функция открытия файла /proc/process_info
   *
   * Вызывается, когда пользователь открывает файл /proc/process_info
-  * Инициализирует последовательное чтение файла
+  * Создает пустой запрос этого файла и инициализирует последовательное чтение
   *
   * @param inode Информация об inode файла
   * @param file Информация о файловом дескрипторе
-  * @return Результат функции single_open
+  * @return 0 при успехе или -ENOMEM
   */
  static int process_info_open(struct inode *inode, struct file *file)
  {
-     return single_open(file, process_info_show, NULL);
+     /* Запрос создается обнуленным и хранится в seq_file->private */
+     struct process_info_request *request =
+         __seq_open_private(file, &process_info_seq_ops, sizeof(*request));
+     
+     return request ? 0 : -ENOMEM;
+ }
+ 
+ /**
+  * @brief Функция закрытия файла /proc/process_info
+  *
+  * Освобождает запрос файла, его буферы и структуры последовательного чтения
+  *
+  * @param inode Информация об inode файла
+  * @param file Информация о файловом дескрипторе
+  * @return Результат функции seq_release_private
+  */
+ static int process_info_release(struct inode *inode, struct file *file)
+ {
+     struct seq_file *m = file->private_data;
+     struct process_info_request *request = m->private;
+     
+     drop_entries(request);
+     kvfree(request->pids);
+     kfree(request->exec_path);
+     kfree(request->cmdline);
+     kfree(request->chunk_pids);
+     kfree(request->chunk_entries);
+     kvfree(request->chunk_records);
+     return seq_release_private(inode, file);
+ }
+ 
+ /**
+  * @brief Разбор текста запроса
+  *
+  * Запрос - слово "all" или список положительных PID, разделенных
+  * пробелами, переводами строк или запятыми
+  *
+  * @param text Текст запроса (изменяется при разборе)
+  * @param request Запрос для заполнения
+  * @return 0 при успехе или отрицательный код ошибки
+  */
+ static int parse_request(char *text, struct process_info_request *request)
+ {
+     char *cursor;
+     char *token;
+     size_t count = 0;
+     bool separator = true;
+     
+     text = strim(text);
+     if (strcmp(text, "all") == 0) {
+         request->all = true;
+         return 0;
+     }
+     
+     /* Первый проход считает PID, чтобы выделить массив один раз */
+     for (cursor = text; *cursor; cursor++) {
+         bool is_separator = strchr(PROCESS_INFO_SEPARATORS, *cursor) != NULL;
+         
+         if (separator && !is_separator)
+             count++;
+         separator = is_separator;
+     }
+     if (count == 0)
+         return -EINVAL;
+     
+     request->pids = kvmalloc_array(count, sizeof(pid_t), GFP_KERNEL);
+     if (!request->pids)
+         return -ENOMEM;
+     
+     /* Второй проход преобразует PID в числа */
+     cursor = text;
+     while ((token = strsep(&cursor, PROCESS_INFO_SEPARATORS)) != NULL) {
+         int pid_value;
+         
+         if (*token == '\0')
+             continue;
+         if (kstrtoint(token, 10, &pid_value) != 0 || pid_value <= 0) {
+             kvfree(request->pids);
+             request->pids = NULL;
+             return -EINVAL;  /* Недопустимый формат или значение PID */
+         }
+         request->pids[request->count++] = pid_value;
+     }
+     return 0;
  }
  
  /**
   * @brief Функция записи в файл /proc/process_info
   *
   * Вызывается, когда пользователь пишет в файл /proc/process_info
-  * Получает PID процесса, о котором нужно собрать информацию
+  * Получает запрос: список PID процессов или "all". Запрос целиком
+  * передается одной записью и заменяет предыдущий запрос этого файла
   *
   * @param file Информация о файловом дескрипторе
   * @param buffer Буфер с данными от пользователя
@@ -214,32 +551,170 @@
  static ssize_t process_info_write(struct file *file, const char __user *buffer, 
                                   size_t len, loff_t *off)
  {
-     char pid_buffer[32];  /* Буфер для строки с PID */
-     long pid_value;       /* Значение PID после преобразования */
+     struct seq_file *m = file->private_data;
+     struct process_info_request *request = m->private;
+     struct process_info_request parsed = { NULL, 0, false };
+     char *text;  /* Текст запроса */
+     int ret;
      
-     /* Проверяем на переполнение буфера */
-     if (len > 31) {
+     /* Проверяем размер запроса */
+     if (len == 0 || len > PROCESS_INFO_MAX_WRITE) {
          return -EINVAL;  /* Недопустимый аргумент */
      }
      
      /* Копируем данные из пользовательского пространства в ядро */
-     if (copy_from_user(pid_buffer, buffer, len)) {
-         return -EFAULT;  /* Ошибка доступа к памяти */
+     text = memdup_user_nul(buffer, len);
+     if (IS_ERR(text)) {
+         return PTR_ERR(text);  /* Ошибка доступа к памяти */
      }
      
-     /* Добавляем нулевой символ в конец строки */
-     pid_buffer[len] = '\0';
-     
-     /* Преобразуем строку в число */
-     if (kstrtol(pid_buffer, 10, &pid_value) != 0) {
-         return -EINVAL;  /* Недопустимый формат числа */
+     ret = parse_request(text, &parsed);
+     kfree(text);
+     if (ret) {
+         return ret;
      }
      
-     /* Сохраняем PID для последующей обработки */
-     requested_pid = (pid_t)pid_value;
+     /* Заменяем только поля запроса: буферы файла служат до его закрытия.
+        Мьютекс seq_file исключает одновременное чтение */
+     mutex_lock(&m->lock);
+     drop_entries(request);
+     kvfree(request->pids);
+     request->pids = parsed.pids;
+     request->count = parsed.count;
+     request->all = parsed.all;
+     mutex_unlock(&m->lock);
      return len;
  }
  
+ /**
+  * @brief Заполнение двоичной записи о процессе
+  *
+  * Вызывается вне RCU. Путь и командная строка копируются сразу в запись,
+  * которая затем целиком передается приложению.
+  *
+  * @param record Заполняемая запись
+  * @param entry Процесс, найденный при проходе под RCU
+  * @param exec_path Буфер размером PATH_MAX для d_path
+  */
+ static void fill_record(struct process_info_record *record,
+                         const struct process_info_entry *entry, char *exec_path)
+ {
+     struct mm_struct *mm;
+     const char *path;
+     bool truncated;
+     int arg_len;
+     
+     /* Обнуляем запись целиком, чтобы не передать приложению содержимое памяти ядра */
+     memset(record, 0, sizeof(*record));
+     record->pid = entry->pid;
+     record->uid = entry->uid;
+     if (!entry->task)
+         return;
+     record->flags = PROCESS_INFO_FOUND;
+     
+     mm = get_task_mm(entry->task);
+     if (!mm)
+         return;
+     
+     path = read_exec_path(mm, exec_path);
+     if (path && strscpy(record->exe, path, sizeof(record->exe)) < 0)
+         record->flags |= PROCESS_INFO_EXE_TRUNCATED;
+     
+     arg_len = read_cmdline(entry->task, mm, record->cmdline, sizeof(record->cmdline), &truncated);
+     if (arg_len > 0)
+         record->cmdline_len = arg_len;
+     if (truncated)
+         record->flags |= PROCESS_INFO_CMDLINE_TRUNCATED;
+     
+     mmput(mm);
+ }
+ 
+ /**
+  * @brief Обработчик ioctl файла /proc/process_info
+  *
+  * PROCESS_INFO_IOC_QUERY: для каждого PID из query.pids заполняет запись
+  * в query.records. PID обрабатываются частями по PROCESS_INFO_CHUNK:
+  * часть находится за один проход под RCU, записи собираются в буфере
+  * открытого файла и копируются приложению одним copy_to_user.
+  *
+  * @param file Информация о файловом дескрипторе
+  * @param cmd Код команды
+  * @param arg Указатель на struct process_info_query в пространстве пользователя
+  * @return 0 при успехе или отрицательный код ошибки
+  */
+ static long process_info_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+ {
+     struct seq_file *m = file->private_data;
+     struct process_info_request *request = m->private;
+     struct process_info_query __user *uquery = (struct process_info_query __user *)arg;
+     struct process_info_query query;
+     const __s32 __user *upids;
+     struct process_info_record __user *urecords;
+     __u32 done = 0;
+     long ret = 0;
+     
+     if (cmd != PROCESS_INFO_IOC_QUERY)
+         return -ENOTTY;
+     if (copy_from_user(&query, uquery, sizeof(query)))
+         return -EFAULT;
+     
+     upids = u64_to_user_ptr(query.pids);
+     urecords = u64_to_user_ptr(query.records);
+     
+     /* Буферы открытого файла общие с текстовым выводом и защищены тем же мьютексом */
+     mutex_lock(&m->lock);
+     if (!request->exec_path)
+         request->exec_path = kmalloc(PATH_MAX, GFP_KERNEL);
+     if (!request->chunk_pids)
+         request->chunk_pids = kmalloc_array(PROCESS_INFO_CHUNK, sizeof(pid_t), GFP_KERNEL);
+     if (!request->chunk_entries)
+         request->chunk_entries = kmalloc_array(PROCESS_INFO_CHUNK,
+                                                sizeof(struct process_info_entry), GFP_KERNEL);
+     if (!request->chunk_records)
+         request->chunk_records = kvmalloc_array(PROCESS_INFO_CHUNK,
+                                                 sizeof(struct process_info_record), GFP_KERNEL);
+     if (!request->exec_path || !request->chunk_pids || !request->chunk_entries ||
+         !request->chunk_records)
+         ret = -ENOMEM;
+     
+     while (!ret && done < query.count) {
+         __u32 n = min_t(__u32, query.count - done, PROCESS_INFO_CHUNK);
+         __u32 i;
+         
+         if (copy_from_user(request->chunk_pids, upids + done, n * sizeof(__s32))) {
+             ret = -EFAULT;
+             break;
+         }
+         
+         /* Находим процессы части за один проход под RCU */
+         rcu_read_lock();
+         for (i = 0; i < n; i++) {
+             pid_t pid = request->chunk_pids[i];
+             struct task_struct *task = pid > 0 ? pid_task(find_vpid(pid), PIDTYPE_PID) : NULL;
+             
+             fill_entry(&request->chunk_entries[i], pid, task);
+         }
+         rcu_read_unlock();
+         
+         for (i = 0; i < n; i++)
+             fill_record(&request->chunk_records[i], &request->chunk_entries[i], request->exec_path);
+         release_entries(request->chunk_entries, n);
+         
+         if (copy_to_user(urecords + done, request->chunk_records,
+                          n * sizeof(struct process_info_record))) {
+             ret = -EFAULT;
+             break;
+         }
+         done += n;
+     }
+     mutex_unlock(&m->lock);
+     
+     /* Сообщаем число заполненных записей, даже если запрос прерван ошибкой */
+     if (put_user(done, &uquery->filled))
+         return -EFAULT;
+     return ret;
+ }
+ 
  /**
   * Определение операций для файла /proc/process_info
   * С учетом различий в API proc_fs между версиями ядра
@@ -251,7 +726,11 @@
      .proc_read = seq_read,                /* Обработчик чтения файла */
      .proc_write = process_info_write,     /* Обработчик записи в файл */
      .proc_lseek = seq_lseek,              /* Обработчик перемещения указателя */
-     .proc_release = single_release,       /* Обработчик закрытия файла */
+     .proc_ioctl = process_info_ioctl,     /* Двоичный запрос */
+ #ifdef CONFIG_COMPAT
+     .proc_compat_ioctl = compat_ptr_ioctl, /* Структуры запроса не зависят от разрядности */
+ #endif
+     .proc_release = process_info_release, /* Обработчик закрытия файла */
  };
  #else
  /* Для более старых ядер используется struct file_operations */
@@ -261,7 +740,8 @@
      .read = seq_read,                     /* Обработчик чтения файла */
      .write = process_info_write,          /* Обработчик записи в файл */
      .llseek = seq_lseek,                  /* Обработчик перемещения указателя */
-     .release = single_release,            /* Обработчик закрытия файла */
+     .unlocked_ioctl = process_info_ioctl, /* Двоичный запрос */
+     .release = process_info_release,      /* Обработчик закрытия файла */
  };
  #endif
  
@@ -0,0 +1,56 @@
+/**
+ * @file process_info_ioctl.h
+ * @brief Двоичный интерфейс модуля process_info
+ *
+ * Общий заголовок модуля ядра и приложения. Ioctl PROCESS_INFO_IOC_QUERY
+ * заполняет массив записей фиксированного размера прямо в буфере приложения,
+ * без текстового форматирования и разбора: по одной записи на каждый PID запроса.
+ */
+
+ #ifndef PROCESS_INFO_IOCTL_H
+ #define PROCESS_INFO_IOCTL_H
+
+ #include <linux/types.h>   /* Для __s32, __u32, __u64 (ядро и пространство пользователя) */
+ #include <linux/ioctl.h>   /* Для _IOWR */
+
+ #define PROCESS_INFO_EXE_MAX 256      /* Размер поля пути к исполняемому файлу */
+ #define PROCESS_INFO_CMDLINE_MAX 512  /* Размер поля командной строки */
+
+ /* Флаги записи */
+ #define PROCESS_INFO_FOUND             0x1  /* Процесс найден */
+ #define PROCESS_INFO_EXE_TRUNCATED     0x2  /* Путь не поместился в поле exe */
+ #define PROCESS_INFO_CMDLINE_TRUNCATED 0x4  /* Командная строка не поместилась в поле cmdline */
+
+ /**
+  * @brief Запись о процессе
+  *
+  * Размер и расположение полей одинаковы для 32- и 64-битных приложений.
+  * Строка exe завершается нулем (пустая, если путь неизвестен). Поле cmdline
+  * содержит cmdline_len байт аргументов, каждый из которых завершается нулем,
+  * как в /proc/<pid>/cmdline.
+  */
+ struct process_info_record {
+     __s32 pid;          /* PID процесса */
+     __s32 uid;          /* UID пользователя процесса (-1, если процесс не найден) */
+     __u32 flags;        /* Флаги PROCESS_INFO_* */
+     __u32 cmdline_len;  /* Число байт в cmdline */
+     char exe[PROCESS_INFO_EXE_MAX];          /* Путь к исполняемому файлу */
+     char cmdline[PROCESS_INFO_CMDLINE_MAX];  /* Командная строка запуска */
+ };
+
+ /**
+  * @brief Аргумент ioctl PROCESS_INFO_IOC_QUERY
+  *
+  * Указатели передаются как __u64, чтобы структура не зависела от разрядности.
+  */
+ struct process_info_query {
+     __u64 pids;     /* Указатель на массив из count значений __s32 */
+     __u64 records;  /* Указатель на массив из count записей process_info_record */
+     __u32 count;    /* Число PID в запросе */
+     __u32 filled;   /* Выход: число заполненных записей */
+ };
+
+ #define PROCESS_INFO_IOC_MAGIC 'p'
+ #define PROCESS_INFO_IOC_QUERY _IOWR(PROCESS_INFO_IOC_MAGIC, 1, struct process_info_query)
+
+ #endif /* PROCESS_INFO_IOCTL_H */
@@ -0,0 +1,207 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "block_io.h"
+#include "bounded_queue.h"
+
+// Фоновый поток ввода-вывода
+// Выполняет запросы чтения в порядке поступления, чтобы поток слияния
+// не ждал диска, пока у него есть данные для обработки
+class IoThread {
+private:
+    BoundedQueue<std::function<void()>> tasks;
+    std::thread worker;
+
+public:
+    // capacity - наибольшее число одновременно ожидающих запросов
+    explicit IoThread(size_t capacity)
+        : tasks(capacity), worker([this] {
+              while (std::optional<std::function<void()>> task = tasks.pop()) {
+                  (*task)();
+              }
+          }) {}
+
+    ~IoThread() {
+        tasks.close();
+        worker.join();
+    }
+
+    IoThread(const IoThread&) = delete;
+    IoThread& operator=(const IoThread&) = delete;
+
+    void submit(std::function<void()> task) {
+        tasks.push(std::move(task));
+    }
+};
+
+// Источник с упреждающим чтением (двойная буферизация)
+// Пока потребитель разбирает текущий блок в BlockReader, фоновый поток уже
+// читает следующий блок во второй буфер. Потребитель ждет только тогда,
+// когда опережающий блок еще не дочитан с диска
+class PrefetchSource : public BlockSource {
+private:
+    std::unique_ptr<BlockSource> inner;
+    IoThread& io;
+    std::vector<char> block;   // опережающий блок
+    size_t blockBegin = 0;     // начало неотданных данных блока
+    size_t blockEnd = 0;       // конец данных блока
+    bool pending = false;      // блок читается фоновым потоком
+    bool exhausted = false;    // внутренний источник исчерпан
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+
+    // Ставит в очередь чтение следующего блока (блок должен быть пуст)
+    void schedule() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = true;
+        }
+        io.submit([this] {
+            const size_t got = inner->read(block.data(), block.size());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                blockBegin = 0;
+                blockEnd = got;
+                exhausted = got == 0;
+                pending = false;
+            }
+            ready.notify_one();
+        });
+    }
+
+public:
+    PrefetchSource(std::unique_ptr<BlockSource> inner, IoThread& io, size_t blockSize)
+        : inner(std::move(inner)), io(io), block(std::max<size_t>(blockSize, 16)) {
+        if (this->inner->isOpen()) {
+            schedule();
+        } else {
+            exhausted = true;
+        }
+    }
+
+    ~PrefetchSource() override {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return !pending; });
+    }
+
+    size_t read(char* target, size_t capacity) override {
+        size_t copied = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return !pending; });
+            if (exhausted) {
+                return 0;
+            }
+            copied = std::min(capacity, blockEnd - blockBegin);
+            std::memcpy(target, block.data() + blockBegin, copied);
+            blockBegin += copied;
+            if (blockBegin < blockEnd) {
+                return copied;
+            }
+        }
+        schedule(); // блок отдан целиком - сразу заказываем следующий
+        return copied;
+    }
+
+    bool isOpen() const override {
+        return inner->isOpen();
+    }
+
+    bool hasFailed() const override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return exhausted && inner->hasFailed();
+    }
+};
+
+// Приемник с отложенной записью
+// write() копирует данные во второй буфер и сразу возвращает управление,
+// а собственный поток приемника сбрасывает их на диск, пока вызывающий
+// заполняет следующий блок
+class WriteBehindSink : public BlockSink {
+private:
+    std::unique_ptr<BlockSink> inner;
+    std::vector<char> pendingData; // данные, ожидающие записи
+    size_t pendingSize = 0;
+    bool hasPending = false;
+    bool stopping = false;
+    bool failed = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this] { return hasPending || stopping; });
+            if (!hasPending) {
+                return;
+            }
+            lock.unlock();
+            const bool written = inner->write(pendingData.data(), pendingSize);
+            lock.lock();
+            failed = failed || !written;
+            hasPending = false;
+            changed.notify_all();
+        }
+    }
+
+    void stop() {
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+
+public:
+    WriteBehindSink(std::unique_ptr<BlockSink> inner, size_t blockSize)
+        : inner(std::move(inner)), pendingData(blockSize), worker([this] { run(); }) {}
+
+    ~WriteBehindSink() override {
+        stop();
+    }
+
+    bool write(const char* data, size_t count) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !hasPending; });
+        if (failed) {
+            return false;
+        }
+        if (pendingData.size() < count) {
+            pendingData.resize(count);
+        }
+        std::memcpy(pendingData.data(), data, count);
+        pendingSize = count;
+        hasPending = true;
+        lock.unlock();
+        changed.notify_all();
+        return true;
+    }
+
+    bool isOpen() const override {
+        return inner->isOpen();
+    }
+
+    bool close() override {
+        stop(); // поток дописывает ожидающий блок перед выходом
+        const bool closed = inner->close();
+        return closed && !failed;
+    }
+};
+
+#endif // ASYNC_IO_H
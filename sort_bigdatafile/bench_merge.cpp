@@ -0,0 +1,122 @@
+// Бенчмарк многопутевого слияния
+// Сравнивает пропускную способность линейного поиска минимума и дерева проигравших
+// при росте числа сливаемых серий k. Серии хранятся в памяти, поэтому измеряется
+// только стоимость выбора следующей записи, без влияния диска
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "loser_tree.h"
+
+// Отсортированная серия ключей с курсором чтения
+struct Run {
+    std::vector<uint64_t> keys;
+    size_t position = 0;
+
+    bool hasNext() const { return position < keys.size(); }
+    uint64_t current() const { return keys[position]; }
+};
+
+// Создает k отсортированных серий общим объемом totalRecords
+static std::vector<Run> makeRuns(size_t k, size_t totalRecords, std::mt19937_64& rng) {
+    std::vector<Run> runs(k);
+    const size_t perRun = totalRecords / k;
+    for (auto& run : runs) {
+        run.keys.resize(perRun);
+        for (auto& key : run.keys) {
+            key = rng() % 1000000007ULL; // ограничиваем диапазон, чтобы встречались дубликаты
+        }
+        std::sort(run.keys.begin(), run.keys.end());
+    }
+    return runs;
+}
+
+// Слияние с линейным поиском минимума, как в исходной версии mergeTempFiles
+static uint64_t mergeLinear(std::vector<Run>& runs) {
+    uint64_t checksum = 0;
+    while (true) {
+        size_t minIndex = 0;
+        bool foundValid = false;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            if (runs[i].hasNext() && (!foundValid || runs[i].current() < runs[minIndex].current())) {
+                minIndex = i;
+                foundValid = true;
+            }
+        }
+        if (!foundValid) {
+            break;
+        }
+        checksum = checksum * 31 + runs[minIndex].current();
+        runs[minIndex].position++;
+    }
+    return checksum;
+}
+
+// Слияние через дерево проигравших
+static uint64_t mergeLoserTree(std::vector<Run>& runs) {
+    auto beats = [&runs](size_t a, size_t b) {
+        if (!runs[a].hasNext() || !runs[b].hasNext()) {
+            return runs[a].hasNext();
+        }
+        if (runs[a].current() != runs[b].current()) {
+            return runs[a].current() < runs[b].current();
+        }
+        return a < b;
+    };
+    LoserTree<decltype(beats)> tree(runs.size(), beats);
+
+    uint64_t checksum = 0;
+    while (runs[tree.top()].hasNext()) {
+        Run& run = runs[tree.top()];
+        checksum = checksum * 31 + run.current();
+        run.position++;
+        tree.replay();
+    }
+    return checksum;
+}
+
+// Измеряет пропускную способность слияния в миллионах записей в секунду
+template <typename Merge>
+static double measure(std::vector<Run> runs, Merge merge, uint64_t& checksum) {
+    size_t total = 0;
+    for (const auto& run : runs) {
+        total += run.keys.size();
+    }
+    auto start = std::chrono::steady_clock::now();
+    checksum = merge(runs);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return seconds > 0 ? total / seconds / 1e6 : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    size_t totalRecords = 1 << 22;
+    if (argc > 1) {
+        totalRecords = std::stoull(argv[1]);
+    }
+
+    std::mt19937_64 rng(42);
+    std::cout << "Записей в слиянии: " << totalRecords << std::endl;
+    // Ширина колонок задана вручную: setw считает байты, а не символы UTF-8
+    std::cout << "       k   линейно, Мзап/с    дерево, Мзап/с" << std::endl;
+
+    for (size_t k : {2, 8, 64, 256, 1024}) {
+        std::vector<Run> runs = makeRuns(k, totalRecords, rng);
+        uint64_t linearSum = 0;
+        uint64_t treeSum = 0;
+        double linear = measure(runs, mergeLinear, linearSum);
+        double tree = measure(runs, mergeLoserTree, treeSum);
+        if (linearSum != treeSum) {
+            std::cerr << "Ошибка: результаты слияния различаются при k = " << k << std::endl;
+            return 1;
+        }
+        std::cout << std::setw(8) << k << std::fixed << std::setprecision(1) << std::setw(18) << linear
+                  << std::setw(18) << tree << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Простой кодек блоков семейства LZ77 (по мотивам LZ4) без внешних зависимостей
+// Блок сжимается независимо от остальных. Сжатые данные - последовательность команд:
+//   token    | 1 байт: старшие 4 бита - длина литералов, младшие - длина совпадения минус 4
+//   литералы | продолжение длины байтами 255...x, если в token 15, затем сами литералы
+//   offset   | 2 байта little-endian: расстояние назад до начала совпадения
+//   match    | продолжение длины совпадения байтами 255...x, если в token 15
+// Последняя команда содержит только литералы. Сжатие быстрое и жадное: совпадения
+// ищутся по хеш-таблице четырехбайтовых последовательностей без цепочек
+class BlockCodec {
+private:
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t LAST_LITERALS = 5; // хвост блока всегда кодируется литералами
+    static constexpr size_t MAX_OFFSET = 65535;
+    static constexpr unsigned HASH_BITS = 12;
+
+    std::vector<uint32_t> table; // последняя позиция (плюс один) для каждого хеша
+
+    static uint32_t read32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t hash(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Записывает продолжение длины (после 15 в token); false - не хватает места
+    static bool putLength(unsigned char*& cursor, const unsigned char* end, size_t length) {
+        while (length >= 255) {
+            if (cursor == end) {
+                return false;
+            }
+            *cursor++ = 255;
+            length -= 255;
+        }
+        if (cursor == end) {
+            return false;
+        }
+        *cursor++ = static_cast<unsigned char>(length);
+        return true;
+    }
+
+    // Читает продолжение длины; false - данные оборваны
+    static bool getLength(const unsigned char*& cursor, const unsigned char* end, size_t& length) {
+        unsigned char byte;
+        do {
+            if (cursor == end) {
+                return false;
+            }
+            byte = *cursor++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Записывает команду: literals литералов с позиции anchor и совпадение длины match
+    // (match = 0 - последняя команда без совпадения)
+    static bool putSequence(unsigned char*& cursor, const unsigned char* end, const unsigned char* anchor,
+                            size_t literals, size_t offset, size_t match) {
+        if (cursor == end) {
+            return false;
+        }
+        unsigned char* token = cursor++;
+        const size_t matchCode = match > 0 ? match - MIN_MATCH : 0;
+        *token = static_cast<unsigned char>((literals < 15 ? literals : 15) << 4 | (matchCode < 15 ? matchCode : 15));
+        if (literals >= 15 && !putLength(cursor, end, literals - 15)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - cursor) < literals) {
+            return false;
+        }
+        std::memcpy(cursor, anchor, literals);
+        cursor += literals;
+        if (match == 0) {
+            return true;
+        }
+        if (end - cursor < 2) {
+            return false;
+        }
+        *cursor++ = static_cast<unsigned char>(offset & 0xFF);
+        *cursor++ = static_cast<unsigned char>(offset >> 8);
+        return matchCode < 15 || putLength(cursor, end, matchCode - 15);
+    }
+
+public:
+    BlockCodec() : table(size_t(1) << HASH_BITS) {}
+
+    // Сжимает size байт source в target емкостью capacity
+    // Возвращает размер сжатых данных или 0, если они не поместились в capacity
+    // (тогда блок выгоднее хранить как есть)
+    size_t compress(const char* source, size_t size, char* target, size_t capacity) {
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(source);
+        unsigned char* cursor = reinterpret_cast<unsigned char*>(target);
+        const unsigned char* end = cursor + capacity;
+        std::fill(table.begin(), table.end(), 0);
+
+        size_t anchor = 0;
+        size_t position = 0;
+        const size_t limit = size > LAST_LITERALS ? size - LAST_LITERALS : 0;
+        while (position + MIN_MATCH <= limit) {
+            const uint32_t sequence = read32(input + position);
+            uint32_t& slot = table[hash(sequence)];
+            const size_t candidate = slot;
+            slot = static_cast<uint32_t>(position + 1);
+            if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET ||
+                read32(input + candidate - 1) != sequence) {
+                ++position;
+                continue;
+            }
+
+            const size_t reference = candidate - 1;
+            size_t match = MIN_MATCH;
+            while (position + match < limit && input[reference + match] == input[position + match]) {
+                ++match;
+            }
+            if (!putSequence(cursor, end, input + anchor, position - anchor, position - reference, match)) {
+                return 0;
+            }
+            position += match;
+            anchor = position;
+        }
+
+        if (!putSequence(cursor, end, input + anchor, size - anchor, 0, 0)) {
+            return 0;
+        }
+        return cursor - reinterpret_cast<unsigned char*>(target);
+    }
+
+    // Распаковывает size байт source ровно в rawSize байт target
+    // Возвращает false, если данные повреждены
+    static bool decompress(const char* source, size_t size, char* target, size_t rawSize) {
+        const unsigned char* cursor = reinterpret_cast<const unsigned char*>(source);
+        const unsigned char* end = cursor + size;
+        unsigned char* output = reinterpret_cast<unsigned char*>(target);
+        size_t written = 0;
+
+        while (cursor < end) {
+            const unsigned char token = *cursor++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !getLength(cursor, end, literals)) {
+                return false;
+            }
+            if (static_cast<size_t>(end - cursor) < literals || rawSize - written < literals) {
+                return false;
+            }
+            std::memcpy(output + written, cursor, literals);
+            cursor += literals;
+            written += literals;
+            if (cursor == end) {
+                break; // последняя команда без совпадения
+            }
+
+            if (end - cursor < 2) {
+                return false;
+            }
+            const size_t offset = cursor[0] | (static_cast<size_t>(cursor[1]) << 8);
+            cursor += 2;
+            size_t match = token & 0x0F;
+            if (match == 15 && !getLength(cursor, end, match)) {
+                return false;
+            }
+            match += MIN_MATCH;
+            if (offset == 0 || offset > written || rawSize - written < match) {
+                return false;
+            }
+            // Совпадение может перекрывать само себя, поэтому копируем побайтно
+            const unsigned char* from = output + written - offset;
+            for (size_t i = 0; i < match; ++i) {
+                output[written + i] = from[i];
+            }
+            written += match;
+        }
+        return written == rawSize;
+    }
+};
+
+#endif // BLOCK_CODEC_H
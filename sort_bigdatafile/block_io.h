@@ -0,0 +1,474 @@
+#ifndef BLOCK_IO_H
+#define BLOCK_IO_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_scan.h"
+
+// Размер блока ввода-вывода по умолчанию
+constexpr size_t IO_BLOCK_SIZE = size_t(4) << 20;
+
+// Счетчики байтов, прочитанных из файлов и stdin и записанных в файлы и stdout за время работы процесса
+struct IoCounters {
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+
+    static IoCounters& global() {
+        static IoCounters counters;
+        return counters;
+    }
+};
+
+// Источник данных для блочного чтения
+class BlockSource {
+public:
+    virtual ~BlockSource() = default;
+
+    // Читает до capacity байт в target; 0 означает конец данных или ошибку
+    virtual size_t read(char* target, size_t capacity) = 0;
+
+    // Источник успешно открыт
+    virtual bool isOpen() const = 0;
+
+    // Произошла ошибка чтения (не конец данных)
+    virtual bool hasFailed() const = 0;
+};
+
+// Синхронное чтение файла
+class FileSource : public BlockSource {
+private:
+    std::ifstream file;
+    bool failed = false;
+
+public:
+    explicit FileSource(const std::string& path) : file(path, std::ios::binary) {}
+
+    // Чтение с заданного смещения
+    FileSource(const std::string& path, uint64_t offset) : file(path, std::ios::binary) {
+        file.seekg(static_cast<std::streamoff>(offset));
+        failed = file.is_open() && !file;
+    }
+
+    size_t read(char* target, size_t capacity) override {
+        if (failed || !file) {
+            return 0;
+        }
+        file.read(target, static_cast<std::streamsize>(capacity));
+        const size_t got = static_cast<size_t>(file.gcount());
+        IoCounters::global().bytesRead.fetch_add(got, std::memory_order_relaxed);
+        if (!file && !file.eof()) {
+            failed = true;
+        }
+        return got;
+    }
+
+    bool isOpen() const override {
+        return file.is_open();
+    }
+
+    bool hasFailed() const override {
+        return failed;
+    }
+};
+
+// Чтение стандартного ввода
+// Данные забираются крупными блоками через std::fread, минуя буфер std::cin
+class StdinSource : public BlockSource {
+private:
+    bool failed = false;
+
+public:
+    size_t read(char* target, size_t capacity) override {
+        if (failed) {
+            return 0;
+        }
+        const size_t got = std::fread(target, 1, capacity, stdin);
+        IoCounters::global().bytesRead.fetch_add(got, std::memory_order_relaxed);
+        if (got < capacity && std::ferror(stdin)) {
+            failed = true;
+        }
+        return got;
+    }
+
+    bool isOpen() const override {
+        return true;
+    }
+
+    bool hasFailed() const override {
+        return failed;
+    }
+};
+
+// Блочное чтение файла
+// Данные читаются крупными блоками через read() в собственный буфер,
+// а строки и двоичные записи выделяются прямо в нем, без посимвольной
+// обработки потоком и без копирования в std::string.
+// Читатель может работать и поверх готовой области памяти (отображенного файла):
+// тогда буфера нет, а выданные представления остаются действительными, пока жива область
+class BlockReader {
+private:
+    std::unique_ptr<BlockSource> source;
+    std::vector<char> buffer;
+    const char* mapped = nullptr; // внешняя область данных вместо буфера
+    size_t begin = 0;        // начало непрочитанных данных в буфере
+    size_t end = 0;          // конец данных в буфере
+    uint64_t consumed = 0;   // количество байт файла, отданных потребителю
+    bool eof = false;        // файл прочитан до конца
+    bool failed = false;     // ошибка чтения
+
+    // Начало читаемых данных: буфер или внешняя область
+    const char* bytes() const {
+        return mapped ? mapped : buffer.data();
+    }
+
+    // Дочитывает данные в буфер, сдвигая непрочитанный остаток в начало
+    // Возвращает false, если новых данных нет
+    bool fill() {
+        if (eof || failed || mapped) {
+            return false;
+        }
+        if (begin > 0) {
+            std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        if (end == buffer.size()) {
+            buffer.resize(buffer.size() * 2); // строка или запись длиннее буфера
+        }
+        const size_t got = source->read(buffer.data() + end, buffer.size() - end);
+        end += got;
+        if (got == 0) {
+            failed = source->hasFailed();
+            eof = !failed;
+        }
+        return got > 0;
+    }
+
+public:
+    explicit BlockReader(const std::string& path, size_t blockSize = IO_BLOCK_SIZE)
+        : BlockReader(std::make_unique<FileSource>(path), blockSize) {}
+
+    BlockReader(std::unique_ptr<BlockSource> source, size_t blockSize)
+        : source(std::move(source)), buffer(std::max<size_t>(blockSize, 16)) {}
+
+    // Чтение из области памяти data размером size, которая переживает читателя
+    BlockReader(const char* data, size_t size) : mapped(data), end(size), eof(true) {}
+
+    explicit operator bool() const {
+        return (mapped || source->isOpen()) && !failed;
+    }
+
+    // Выданные строки и данные действительны все время жизни читаемой области,
+    // а не только до следующего вызова
+    bool hasStableViews() const {
+        return mapped != nullptr;
+    }
+
+    // Произошла ошибка чтения (не конец файла)
+    bool hasFailed() const {
+        return failed;
+    }
+
+    // Количество байт файла, уже отданных потребителю
+    uint64_t position() const {
+        return consumed;
+    }
+
+    // Выделяет очередную строку без символа перевода строки
+    // Представление действительно до следующего вызова любого метода чтения.
+    // Как и std::getline, последняя строка без перевода строки тоже возвращается
+    bool nextLine(std::string_view& line) {
+        size_t scanned = begin;
+        while (true) {
+            const char* start = bytes() + begin;
+            const void* found = std::memchr(bytes() + scanned, '\n', end - scanned);
+            if (found) {
+                const size_t length = static_cast<const char*>(found) - start;
+                line = std::string_view(start, length);
+                begin += length + 1;
+                consumed += length + 1;
+                return true;
+            }
+            scanned = end - begin; // после fill() остаток окажется в начале буфера
+            if (!fill()) {
+                if (begin == end) {
+                    return false;
+                }
+                line = std::string_view(bytes() + begin, end - begin);
+                consumed += end - begin;
+                begin = end;
+                return true;
+            }
+        }
+    }
+
+    // Выделяет очередную строку, как nextLine(line), и за тот же проход находит
+    // в ней первое двоеточие: colon - его позиция в строке или line.size(), если его нет.
+    // До двоеточия ищется сразу любой из двух разделителей, после него - только '\n',
+    // поэтому каждый байт строки просматривается один раз
+    bool nextLine(std::string_view& line, size_t& colon) {
+        size_t scanned = 0;           // просмотрено байт от begin
+        size_t colonAt = SIZE_MAX;    // смещение двоеточия от begin
+        while (true) {
+            const char* start = bytes() + begin;
+            const char* limit = bytes() + end;
+            const char* found = start + scanned;
+            if (colonAt == SIZE_MAX) {
+                found = findFirstOf(found, limit, ':', '\n');
+                if (found != limit && *found == ':') {
+                    colonAt = found - start;
+                    found = findByte(found + 1, limit, '\n');
+                }
+            } else {
+                found = findByte(found, limit, '\n');
+            }
+            if (found != limit) {
+                const size_t length = found - start;
+                line = std::string_view(start, length);
+                colon = std::min(colonAt, length);
+                begin += length + 1;
+                consumed += length + 1;
+                return true;
+            }
+            scanned = end - begin; // после fill() остаток окажется в начале буфера
+            if (!fill()) {
+                if (begin == end) {
+                    return false;
+                }
+                line = std::string_view(bytes() + begin, end - begin);
+                colon = std::min(colonAt, line.size());
+                consumed += end - begin;
+                begin = end;
+                return true;
+            }
+        }
+    }
+
+    // Гарантирует наличие в буфере не менее count байт подряд
+    // Возвращает количество доступных байт (меньше count только в конце файла)
+    size_t require(size_t count) {
+        while (end - begin < count) {
+            if (!mapped && buffer.size() < count) {
+                buffer.resize(count);
+            }
+            if (!fill()) {
+                break;
+            }
+        }
+        return end - begin;
+    }
+
+    // Непрочитанные данные буфера
+    const char* data() const {
+        return bytes() + begin;
+    }
+
+    // Отмечает count байт буфера как прочитанные
+    void consume(size_t count) {
+        begin += count;
+        consumed += count;
+    }
+
+    // Читает ровно count байт; возвращает false, если файл кончился раньше
+    bool read(char* target, size_t count) {
+        while (count > 0) {
+            if (begin == end && !fill()) {
+                return false;
+            }
+            const size_t chunk = std::min(count, end - begin);
+            std::memcpy(target, bytes() + begin, chunk);
+            consume(chunk);
+            target += chunk;
+            count -= chunk;
+        }
+        return true;
+    }
+};
+
+// Приемник данных для блочной записи
+class BlockSink {
+public:
+    virtual ~BlockSink() = default;
+
+    // Записывает count байт; возвращает false при ошибке
+    virtual bool write(const char* data, size_t count) = 0;
+
+    // Приемник успешно открыт
+    virtual bool isOpen() const = 0;
+
+    // Завершает запись; возвращает false, если какая-либо запись не удалась
+    virtual bool close() = 0;
+};
+
+// Синхронная запись в файл
+class FileSink : public BlockSink {
+private:
+    std::ofstream file;
+
+public:
+    explicit FileSink(const std::string& path) : file(path, std::ios::binary | std::ios::trunc) {}
+
+    // Запись в существующий файл с заданного смещения, не затирая остальное содержимое
+    FileSink(const std::string& path, uint64_t offset) : file(path, std::ios::binary | std::ios::in | std::ios::out) {
+        file.seekp(static_cast<std::streamoff>(offset));
+    }
+
+    bool write(const char* data, size_t count) override {
+        file.write(data, static_cast<std::streamsize>(count));
+        IoCounters::global().bytesWritten.fetch_add(count, std::memory_order_relaxed);
+        return static_cast<bool>(file);
+    }
+
+    bool isOpen() const override {
+        return file.is_open();
+    }
+
+    bool close() override {
+        if (!file.is_open()) {
+            return !file.fail();
+        }
+        file.close();
+        return !file.fail();
+    }
+};
+
+// Запись в стандартный вывод
+// Блоки передаются std::fwrite целиком, поэтому вывод начинается с первого сброшенного блока
+class StdoutSink : public BlockSink {
+private:
+    bool failed = false;
+
+public:
+    bool write(const char* data, size_t count) override {
+        IoCounters::global().bytesWritten.fetch_add(count, std::memory_order_relaxed);
+        failed = failed || std::fwrite(data, 1, count, stdout) != count;
+        return !failed;
+    }
+
+    bool isOpen() const override {
+        return true;
+    }
+
+    bool close() override {
+        failed = failed || std::fflush(stdout) != 0;
+        return !failed;
+    }
+};
+
+// Блочная запись файла
+// Данные копируются в крупный буфер и сбрасываются в приемник одним write(),
+// ключи форматируются через std::to_chars без учета локали
+class BlockWriter {
+private:
+    std::unique_ptr<BlockSink> sink;
+    std::vector<char> buffer;
+    size_t used = 0;
+    bool failed = false;
+
+public:
+    explicit BlockWriter(const std::string& path, size_t blockSize = IO_BLOCK_SIZE)
+        : BlockWriter(std::make_unique<FileSink>(path), blockSize) {}
+
+    BlockWriter(std::unique_ptr<BlockSink> sink, size_t blockSize)
+        : sink(std::move(sink)), buffer(std::max<size_t>(blockSize, 64)) {}
+
+    ~BlockWriter() {
+        close();
+    }
+
+    BlockWriter(const BlockWriter&) = delete;
+    BlockWriter& operator=(const BlockWriter&) = delete;
+
+    explicit operator bool() const {
+        return sink->isOpen() && !failed;
+    }
+
+    // Сбрасывает накопленные данные в приемник
+    void flush() {
+        if (used > 0) {
+            failed = !sink->write(buffer.data(), used) || failed;
+            used = 0;
+        }
+    }
+
+    // Резервирует в буфере count байт подряд и возвращает указатель на них
+    char* reserve(size_t count) {
+        if (buffer.size() - used < count) {
+            flush();
+            if (buffer.size() < count) {
+                buffer.resize(count);
+            }
+        }
+        return buffer.data() + used;
+    }
+
+    // Отмечает count зарезервированных байт как записанные
+    void commit(size_t count) {
+        used += count;
+    }
+
+    void write(const char* data, size_t count) {
+        if (count >= buffer.size()) {
+            flush();
+            failed = !sink->write(data, count) || failed;
+            return;
+        }
+        std::memcpy(reserve(count), data, count);
+        commit(count);
+    }
+
+    void put(char c) {
+        *reserve(1) = c;
+        commit(1);
+    }
+
+    // Длина строки результата "key:value\n", которую запишет writeLine
+    static size_t lineLength(uint64_t key, size_t valueSize) {
+        size_t digits = 1;
+        for (uint64_t bound = 10; digits < 20 && key >= bound; bound *= 10) {
+            ++digits;
+        }
+        return digits + valueSize + 2;
+    }
+
+    // Записывает строку результата "key:value\n"
+    void writeLine(uint64_t key, std::string_view value) {
+        constexpr size_t MAX_KEY_DIGITS = 20;
+        if (value.size() + MAX_KEY_DIGITS + 2 > buffer.size()) {
+            char digits[MAX_KEY_DIGITS];
+            const char* digitsEnd = std::to_chars(digits, digits + MAX_KEY_DIGITS, key).ptr;
+            write(digits, digitsEnd - digits);
+            put(':');
+            write(value.data(), value.size());
+            put('\n');
+            return;
+        }
+        char* start = reserve(value.size() + MAX_KEY_DIGITS + 2);
+        char* cursor = std::to_chars(start, start + MAX_KEY_DIGITS, key).ptr;
+        *cursor++ = ':';
+        std::memcpy(cursor, value.data(), value.size());
+        cursor += value.size();
+        *cursor++ = '\n';
+        commit(cursor - start);
+    }
+
+    // Завершает запись; возвращает false при ошибке ввода-вывода
+    bool close() {
+        flush();
+        failed = !sink->close() || failed;
+        return !failed;
+    }
+};
+
+#endif // BLOCK_IO_H
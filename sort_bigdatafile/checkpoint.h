@@ -0,0 +1,240 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "block_io.h"
+#include "run_format.h"
+
+// Контрольные точки для продолжения прерванной сортировки (--resume)
+// ===================================================================
+// Манифест <результат>.manifest - текстовый журнал, строки которого дописываются
+// по мере завершения работы и сбрасываются на диск сразу:
+//   SBDM 2                                           | заголовок и версия
+//   input <size> <mtime> <flags> <generation> <path> | вход (размер и время изменения), флаги серий
+//                                                    | и способ их формирования
+//   run <n> <inputEnd> <lines>                       | серия n записана: она заканчивается на смещении
+//                                                    | inputEnd входа, к этому месту принято lines строк
+//   generated <count> <inputEnd> <lines>             | формирование серий завершено, серий count
+//   merge <target> <run>...                          | соседние серии слиты в промежуточную target
+// Время изменения входа отличает перезаписанный файл того же размера: с ним манифест
+// не совпадет и сортировка начнется заново, а не продолжится по устаревшим сериям.
+// Рядом с каждой серией лежит ее разреженный индекс <серия>.idx (формат ниже), чтобы
+// после перезапуска последнее слияние снова могло идти параллельно по диапазонам.
+// Строка о серии пишется только после закрытия серии и ее индекса, а исходные серии
+// слияния удаляются только после строки merge, поэтому журнал не ссылается на
+// недописанные файлы. Записи сбрасываются в ОС, но без fsync: переживается
+// завершение процесса, но не обязательно потеря питания
+
+constexpr char RUN_INDEX_MAGIC[4] = {'S', 'B', 'D', 'I'};
+constexpr uint16_t RUN_INDEX_VERSION = 1;
+
+// Файл с индексом серии:
+//   magic     | 4 байта "SBDI"
+//   version   | uint16 little-endian
+//   flags     | uint16 little-endian, флаги серии
+//   textBytes | uint64 little-endian
+//   count     | uint64 little-endian
+//   samples   | count точек по три uint64 little-endian: key, offset, textBytes
+inline bool writeRunIndexFile(const std::string& path, const RunIndex& index) {
+    BlockWriter file(path, 64 * 1024);
+    if (!file) {
+        return false;
+    }
+    auto put64 = [&file](uint64_t number) {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<char>(number >> (8 * i));
+        }
+        file.write(bytes, sizeof(bytes));
+    };
+    const char header[8] = {RUN_INDEX_MAGIC[0], RUN_INDEX_MAGIC[1], RUN_INDEX_MAGIC[2], RUN_INDEX_MAGIC[3],
+                            static_cast<char>(RUN_INDEX_VERSION & 0xFF), static_cast<char>(RUN_INDEX_VERSION >> 8),
+                            static_cast<char>(index.flags & 0xFF), static_cast<char>(index.flags >> 8)};
+    file.write(header, sizeof(header));
+    put64(index.textBytes);
+    put64(index.samples.size());
+    for (const RunSample& sample : index.samples) {
+        put64(sample.key);
+        put64(sample.offset);
+        put64(sample.textBytes);
+    }
+    return file.close();
+}
+
+// Читает индекс серии; false, если файла нет или он поврежден
+inline bool readRunIndexFile(const std::string& path, RunIndex& index) {
+    BlockReader file(path, 64 * 1024);
+    auto get64 = [](const char* bytes) {
+        uint64_t number = 0;
+        for (int i = 0; i < 8; ++i) {
+            number |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        }
+        return number;
+    };
+    char header[24];
+    if (!file || !file.read(header, sizeof(header)) ||
+        std::string_view(header, 4) != std::string_view(RUN_INDEX_MAGIC, 4) ||
+        (static_cast<uint8_t>(header[4]) | (static_cast<uint8_t>(header[5]) << 8)) != RUN_INDEX_VERSION) {
+        return false;
+    }
+    index = RunIndex();
+    index.flags = static_cast<uint16_t>(static_cast<uint8_t>(header[6]) | (static_cast<uint8_t>(header[7]) << 8));
+    index.textBytes = get64(header + 8);
+    const uint64_t count = get64(header + 16);
+    char sample[24];
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!file.read(sample, sizeof(sample))) {
+            return false;
+        }
+        index.samples.push_back(RunSample{get64(sample), get64(sample + 8), get64(sample + 16)});
+    }
+    return true;
+}
+
+// Место во входе, до которого он обработан
+struct InputCheckpoint {
+    uint64_t inputEnd = 0; // смещение во входном файле
+    uint64_t lines = 0;    // принято строк до этого смещения
+};
+
+// Состояние, восстановленное из манифеста
+struct CheckpointState {
+    std::map<size_t, InputCheckpoint> runs; // записанные начальные серии
+    bool generated = false;                 // формирование серий завершено
+    size_t runCount = 0;                    // число начальных серий (если generated)
+    InputCheckpoint end;                    // конец входа (если generated)
+    std::vector<std::pair<size_t, std::vector<size_t>>> merges; // промежуточные слияния по порядку
+};
+
+// Журнал контрольных точек
+// Строки дописываются из потока записи серий и из потока слияния, поэтому под мьютексом
+class CheckpointManifest {
+private:
+    const std::string path;
+    const std::string header; // строка input, описывающая вход и параметры серий
+    std::ofstream file;
+    std::mutex mutex;
+
+    void append(const std::string& line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        file << line << std::endl; // сбрасываем сразу: строка должна пережить аварийное завершение
+    }
+
+public:
+    CheckpointManifest(std::string path, const std::string& inputPath, uint64_t inputSize,
+                       int64_t inputModified, uint16_t flags, int generation)
+        : path(std::move(path)),
+          header("input " + std::to_string(inputSize) + " " + std::to_string(inputModified) + " " +
+                 std::to_string(flags) + " " + std::to_string(generation) + " " + inputPath) {}
+
+    // Читает манифест предыдущего запуска с тем же входом и параметрами
+    // false - манифеста нет, он от другого входа или поврежден
+    bool load(CheckpointState& state) const {
+        std::ifstream input(path);
+        std::string line;
+        if (!std::getline(input, line) || line != "SBDM 2" || !std::getline(input, line) || line != header) {
+            return false;
+        }
+        state = CheckpointState();
+        while (std::getline(input, line)) {
+            if (input.eof()) {
+                break; // строка без перевода строки оборвана при записи
+            }
+            std::istringstream fields(line);
+            std::string kind;
+            fields >> kind;
+            if (kind == "run") {
+                size_t run = 0;
+                InputCheckpoint checkpoint;
+                if (!(fields >> run >> checkpoint.inputEnd >> checkpoint.lines)) {
+                    break;
+                }
+                state.runs[run] = checkpoint;
+            } else if (kind == "generated") {
+                if (!(fields >> state.runCount >> state.end.inputEnd >> state.end.lines)) {
+                    break;
+                }
+                state.generated = true;
+            } else if (kind == "merge") {
+                size_t target = 0;
+                std::vector<size_t> group;
+                size_t run = 0;
+                if (!(fields >> target)) {
+                    break;
+                }
+                while (fields >> run) {
+                    group.push_back(run);
+                }
+                if (group.size() < 2) {
+                    break;
+                }
+                state.merges.emplace_back(target, std::move(group));
+            } else {
+                break;
+            }
+        }
+        return true;
+    }
+
+    // Начинает манифест заново; состояние продолжаемого запуска переносится в него
+    bool create(const CheckpointState& state) {
+        std::lock_guard<std::mutex> lock(mutex);
+        file.close();
+        file.clear();
+        file.open(path, std::ios::trunc);
+        file << "SBDM 2\n" << header << "\n";
+        for (const auto& [run, checkpoint] : state.runs) {
+            file << "run " << run << " " << checkpoint.inputEnd << " " << checkpoint.lines << "\n";
+        }
+        if (state.generated) {
+            file << "generated " << state.runCount << " " << state.end.inputEnd << " " << state.end.lines << "\n";
+        }
+        for (const auto& [target, group] : state.merges) {
+            file << "merge " << target;
+            for (size_t run : group) {
+                file << " " << run;
+            }
+            file << "\n";
+        }
+        file.flush();
+        return static_cast<bool>(file);
+    }
+
+    void recordRun(size_t run, const InputCheckpoint& checkpoint) {
+        append("run " + std::to_string(run) + " " + std::to_string(checkpoint.inputEnd) + " " +
+               std::to_string(checkpoint.lines));
+    }
+
+    void recordGenerated(size_t runCount, const InputCheckpoint& end) {
+        append("generated " + std::to_string(runCount) + " " + std::to_string(end.inputEnd) + " " +
+               std::to_string(end.lines));
+    }
+
+    void recordMerge(size_t target, const std::vector<size_t>& group) {
+        std::string line = "merge " + std::to_string(target);
+        for (size_t run : group) {
+            line += " " + std::to_string(run);
+        }
+        append(line);
+    }
+
+    // Сортировка завершена - манифест больше не нужен
+    void remove() {
+        std::lock_guard<std::mutex> lock(mutex);
+        file.close();
+        std::remove(path.c_str());
+    }
+};
+
+#endif // CHECKPOINT_H
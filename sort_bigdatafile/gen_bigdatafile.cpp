@@ -0,0 +1,181 @@
+// Генератор входных данных для sort_bigdatafile
+// Быстрая замена gen_bigdatafile.py для больших объемов: строки "key:value"
+// формируются в буфере и пишутся блоками, случайные числа дает splitmix64.
+// Распределение ключей и длина значений задаются предустановками, чтобы
+// бенчмарк проверял и типичный, и крайние случаи сортировки
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "block_io.h"
+
+// Распределение ключей
+enum class KeyDistribution {
+    Uniform,    // равномерно по всему диапазону uint64
+    Duplicates, // немного различных ключей, много повторов
+    Sorted,     // уже упорядоченные по возрастанию
+    Reverse     // упорядоченные по убыванию
+};
+
+// Параметры генерации
+struct GeneratorOptions {
+    uint64_t lines = 0;
+    std::string outputPath;
+    KeyDistribution keys = KeyDistribution::Uniform;
+    size_t minValueLength = 5;  // как в gen_bigdatafile.py
+    size_t maxValueLength = 15;
+    uint64_t seed = 42;
+
+    // Число различных ключей в режиме duplicates
+    static constexpr uint64_t DUPLICATE_KEYS = 1000;
+};
+
+// Генератор псевдослучайных чисел splitmix64
+class SplitMix64 {
+private:
+    uint64_t state;
+
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Число из [0, bound); смещение распределения при bound много меньше 2^64 ничтожно
+    uint64_t below(uint64_t bound) {
+        return next() % bound;
+    }
+};
+
+// Ключ строки index
+static uint64_t makeKey(const GeneratorOptions& options, uint64_t index, SplitMix64& random) {
+    // Шаг упорядоченных ключей: пройти весь диапазон uint64 за lines строк
+    const uint64_t step = UINT64_MAX / (options.lines > 0 ? options.lines : 1);
+    switch (options.keys) {
+        case KeyDistribution::Duplicates:
+            return random.below(GeneratorOptions::DUPLICATE_KEYS) * 0x9E3779B97F4A7C15ULL;
+        case KeyDistribution::Sorted:
+            return index * step + random.below(step);
+        case KeyDistribution::Reverse:
+            return (options.lines - 1 - index) * step + random.below(step);
+        case KeyDistribution::Uniform:
+        default:
+            return random.next();
+    }
+}
+
+// Разбирает длину значения вида N или MIN-MAX
+static bool parseValueLength(std::string_view text, size_t& minLength, size_t& maxLength) {
+    const size_t dash = text.find('-');
+    const std::string_view first = text.substr(0, dash);
+    const std::string_view second = dash == std::string_view::npos ? first : text.substr(dash + 1);
+    auto parse = [](std::string_view part, size_t& value) {
+        auto result = std::from_chars(part.data(), part.data() + part.size(), value);
+        return result.ec == std::errc() && result.ptr == part.data() + part.size();
+    };
+    return parse(first, minLength) && parse(second, maxLength) && minLength <= maxLength;
+}
+
+// Выводит справку по использованию генератора
+static void printUsage(const char* programName) {
+    std::cerr << "Использование: " << programName << " [опции] <число_строк> <выходной_файл>" << std::endl;
+    std::cerr << "Опции:" << std::endl;
+    std::cerr << "  --keys=uniform|duplicates|sorted|reverse распределение ключей (по умолчанию uniform)" << std::endl;
+    std::cerr << "  --value-length=<N>|<MIN>-<MAX>          длина значений (по умолчанию 5-15)" << std::endl;
+    std::cerr << "  --seed=<N>                              начальное значение генератора (по умолчанию 42)" << std::endl;
+}
+
+// Разбирает аргументы командной строки
+static bool parseArguments(int argc, char* argv[], GeneratorOptions& options) {
+    std::string positional[2];
+    size_t positionalCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--keys=uniform") {
+            options.keys = KeyDistribution::Uniform;
+        } else if (arg == "--keys=duplicates") {
+            options.keys = KeyDistribution::Duplicates;
+        } else if (arg == "--keys=sorted") {
+            options.keys = KeyDistribution::Sorted;
+        } else if (arg == "--keys=reverse") {
+            options.keys = KeyDistribution::Reverse;
+        } else if (arg.rfind("--value-length=", 0) == 0) {
+            if (!parseValueLength(std::string_view(arg).substr(15), options.minValueLength, options.maxValueLength)) {
+                std::cerr << "Ошибка: некорректная длина значений: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            auto result = std::from_chars(arg.data() + 7, arg.data() + arg.size(), options.seed);
+            if (result.ec != std::errc() || result.ptr != arg.data() + arg.size()) {
+                std::cerr << "Ошибка: некорректное начальное значение: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Ошибка: неизвестная опция " << arg << std::endl;
+            return false;
+        } else if (positionalCount < 2) {
+            positional[positionalCount++] = arg;
+        } else {
+            return false;
+        }
+    }
+
+    if (positionalCount != 2) {
+        return false;
+    }
+    auto result = std::from_chars(positional[0].data(), positional[0].data() + positional[0].size(), options.lines);
+    if (result.ec != std::errc() || result.ptr != positional[0].data() + positional[0].size()) {
+        std::cerr << "Ошибка: некорректное число строк: " << positional[0] << std::endl;
+        return false;
+    }
+    options.outputPath = positional[1];
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    BlockWriter output(options.outputPath);
+    if (!output) {
+        std::cerr << "Ошибка: не удалось создать файл " << options.outputPath << std::endl;
+        return 1;
+    }
+
+    static constexpr char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    constexpr uint64_t ALPHABET_SIZE = sizeof(ALPHABET) - 1;
+    const size_t lengthSpread = options.maxValueLength - options.minValueLength + 1;
+
+    SplitMix64 random(options.seed);
+    std::string value;
+    for (uint64_t index = 0; index < options.lines; ++index) {
+        const uint64_t key = makeKey(options, index, random);
+        value.resize(options.minValueLength + random.below(lengthSpread));
+        // Одного 64-битного числа хватает на 10 символов алфавита из 62 знаков
+        uint64_t bits = 0;
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (i % 10 == 0) {
+                bits = random.next();
+            }
+            value[i] = ALPHABET[bits % ALPHABET_SIZE];
+            bits /= ALPHABET_SIZE;
+        }
+        output.writeLine(key, value);
+    }
+
+    if (!output.close()) {
+        std::cerr << "Ошибка записи файла " << options.outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Файл " << options.outputPath << " успешно создан с " << options.lines << " строками." << std::endl;
+    return 0;
+}
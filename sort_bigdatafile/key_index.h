@@ -0,0 +1,160 @@
+#ifndef KEY_INDEX_H
+#define KEY_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "block_io.h"
+
+// Разреженный индекс файла результата (<результат>.idx)
+// =====================================================
+// Заголовок (24 байта):
+//   magic      | 4 байта "SBDX"
+//   version    | uint16 little-endian, текущая версия KEY_INDEX_VERSION
+//   reserved   | uint16, 0
+//   outputSize | uint64 little-endian, размер файла результата в байтах
+//   count      | uint64 little-endian, число точек
+// Далее count точек по возрастанию смещения (и, значит, ключа):
+//   key        | uint64 little-endian, ключ строки
+//   offset     | uint64 little-endian, смещение начала этой строки в результате
+//
+// Точки ставятся примерно через KeyIndexBuilder::INTERVAL байт результата, поэтому
+// поиск ключа читает из результата один-два блока такого размера вместо всего файла
+
+constexpr char KEY_INDEX_MAGIC[4] = {'S', 'B', 'D', 'X'};
+constexpr uint16_t KEY_INDEX_VERSION = 1;
+constexpr size_t KEY_INDEX_HEADER_SIZE = 24;
+constexpr size_t KEY_INDEX_ENTRY_SIZE = 16;
+
+// Точка индекса результата
+struct KeyIndexEntry {
+    uint64_t key = 0;    // ключ строки
+    uint64_t offset = 0; // смещение строки в файле результата
+};
+
+// Собирает точки индекса по мере записи строк результата
+class KeyIndexBuilder {
+private:
+    std::vector<KeyIndexEntry> entries;
+    uint64_t position = 0;   // смещение следующей строки
+    uint64_t nextSample = 0; // смещение, начиная с которого ставится следующая точка
+
+public:
+    // Расстояние между точками в байтах результата
+    static constexpr uint64_t INTERVAL = 64 * 1024;
+
+    // Строки пишутся в результат начиная со смещения offset
+    explicit KeyIndexBuilder(uint64_t offset = 0) : position(offset), nextSample(offset) {}
+
+    // Учитывает строку с ключом key длиной lineLength байт
+    void add(uint64_t key, uint64_t lineLength) {
+        if (position >= nextSample) {
+            entries.push_back(KeyIndexEntry{key, position});
+            nextSample = position + INTERVAL;
+        }
+        position += lineLength;
+    }
+
+    // Смещение за последней учтенной строкой
+    uint64_t getPosition() const {
+        return position;
+    }
+
+    const std::vector<KeyIndexEntry>& getEntries() const {
+        return entries;
+    }
+};
+
+// Записывает индекс результата размером outputSize байт в path
+// Возвращает false при ошибке ввода-вывода
+inline bool writeKeyIndex(const std::string& path, const std::vector<KeyIndexEntry>& entries, uint64_t outputSize) {
+    BlockWriter file(path, 64 * 1024);
+    if (!file) {
+        return false;
+    }
+    auto put64 = [&file](uint64_t number) {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<char>(number >> (8 * i));
+        }
+        file.write(bytes, sizeof(bytes));
+    };
+    const char header[8] = {KEY_INDEX_MAGIC[0], KEY_INDEX_MAGIC[1], KEY_INDEX_MAGIC[2], KEY_INDEX_MAGIC[3],
+                            static_cast<char>(KEY_INDEX_VERSION & 0xFF), static_cast<char>(KEY_INDEX_VERSION >> 8),
+                            0, 0};
+    file.write(header, sizeof(header));
+    put64(outputSize);
+    put64(entries.size());
+    for (const KeyIndexEntry& entry : entries) {
+        put64(entry.key);
+        put64(entry.offset);
+    }
+    return file.close();
+}
+
+// Загруженный индекс результата
+class KeyIndex {
+private:
+    std::vector<KeyIndexEntry> entries;
+    uint64_t outputSize = 0;
+
+    static uint64_t get64(const char* bytes) {
+        uint64_t number = 0;
+        for (int i = 0; i < 8; ++i) {
+            number |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        }
+        return number;
+    }
+
+public:
+    // Читает индекс из path; false, если файла нет или он поврежден
+    bool load(const std::string& path) {
+        BlockReader file(path, 64 * 1024);
+        char header[KEY_INDEX_HEADER_SIZE];
+        if (!file || !file.read(header, KEY_INDEX_HEADER_SIZE) ||
+            std::string_view(header, 4) != std::string_view(KEY_INDEX_MAGIC, 4) ||
+            (static_cast<uint8_t>(header[4]) | (static_cast<uint8_t>(header[5]) << 8)) != KEY_INDEX_VERSION) {
+            return false;
+        }
+        outputSize = get64(header + 8);
+        const uint64_t count = get64(header + 16);
+
+        entries.clear();
+        char entry[KEY_INDEX_ENTRY_SIZE];
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!file.read(entry, KEY_INDEX_ENTRY_SIZE)) {
+                return false;
+            }
+            entries.push_back(KeyIndexEntry{get64(entry), get64(entry + 8)});
+            if (i > 0 && (entries[i].offset <= entries[i - 1].offset || entries[i].key < entries[i - 1].key)) {
+                return false;
+            }
+        }
+        return entries.empty() || entries.back().offset < outputSize;
+    }
+
+    // Размер файла результата, для которого построен индекс
+    uint64_t getOutputSize() const {
+        return outputSize;
+    }
+
+    // Смещение, с которого в результате начинаются строки с ключами не меньше low
+    // Перед ним все ключи меньше low, но после него могут встретиться и меньшие:
+    // берем последнюю точку со строго меньшим ключом, так как равные ключи
+    // могут начинаться раньше точки с ключом low
+    uint64_t startOffset(uint64_t low) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), low,
+                                   [](const KeyIndexEntry& entry, uint64_t key) {
+                                       return entry.key < key;
+                                   });
+        return it == entries.begin() ? 0 : std::prev(it)->offset;
+    }
+};
+
+#endif // KEY_INDEX_H
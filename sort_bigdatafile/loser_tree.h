@@ -0,0 +1,63 @@
+#ifndef LOSER_TREE_H
+#define LOSER_TREE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Дерево проигравших (турнирное дерево) для многопутевого слияния
+// Хранит номера источников: во внутренних узлах - проигравших в поединке,
+// в корне - общего победителя. После продвижения победителя достаточно
+// переиграть путь от его листа до корня, что стоит O(log k) сравнений вместо O(k).
+//
+// Beats(a, b) должен возвращать true, если текущая запись источника a идет раньше
+// записи источника b. Это строгий порядок: исчерпанные источники проигрывают всем,
+// а равные ключи упорядочиваются по номеру источника, что и дает устойчивость слияния
+template <typename Beats>
+class LoserTree {
+private:
+    size_t leaves;
+    std::vector<size_t> tree; // tree[0] - победитель, tree[1..leaves-1] - проигравшие
+    Beats beats;
+
+    // Строит поддерево с корнем node и возвращает его победителя
+    size_t build(size_t node) {
+        if (node >= leaves) {
+            return node - leaves;
+        }
+        size_t left = build(2 * node);
+        size_t right = build(2 * node + 1);
+        if (beats(left, right)) {
+            tree[node] = right;
+            return left;
+        }
+        tree[node] = left;
+        return right;
+    }
+
+public:
+    LoserTree(size_t sourceCount, Beats beats)
+        : leaves(sourceCount), tree(sourceCount > 0 ? sourceCount : 1, 0), beats(std::move(beats)) {
+        if (leaves > 0) {
+            tree[0] = build(1);
+        }
+    }
+
+    // Номер источника с наименьшей текущей записью
+    size_t top() const {
+        return tree[0];
+    }
+
+    // Восстанавливает дерево после того, как источник top() перешел к следующей записи
+    void replay() {
+        size_t winner = tree[0];
+        for (size_t node = (winner + leaves) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], winner)) {
+                std::swap(tree[node], winner);
+            }
+        }
+        tree[0] = winner;
+    }
+};
+
+#endif // LOSER_TREE_H
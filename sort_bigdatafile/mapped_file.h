@@ -0,0 +1,118 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Платформенная прослойка отображения файла в память
+// Единственное место программы, обращающееся к системному API. Там, где отображение
+// недоступно (неизвестная платформа или 32-битный адрес, в который не помещается
+// большой файл), isMapped() возвращает false и вызывающий читает файл потоком
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_POSIX
+#endif
+
+// Отображение всего файла в память только для чтения
+class MappedFile {
+private:
+    const char* view = nullptr; // начало отображения
+    size_t viewSize = 0;        // размер отображения
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    // Весь файл отображается одним куском, поэтому он должен помещаться в адресное пространство
+    static bool fitsAddressSpace(uint64_t size) {
+        return sizeof(void*) >= 8 && size <= SIZE_MAX;
+    }
+
+public:
+    explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+            !fitsAddressSpace(static_cast<uint64_t>(size.QuadPart))) {
+            return;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            return;
+        }
+        view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        viewSize = view ? static_cast<size_t>(size.QuadPart) : 0;
+#elif defined(MAPPED_FILE_POSIX)
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return;
+        }
+        struct stat status;
+        if (::fstat(descriptor, &status) == 0 && status.st_size > 0 &&
+            fitsAddressSpace(static_cast<uint64_t>(status.st_size))) {
+            const size_t size = static_cast<size_t>(status.st_size);
+            void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (address != MAP_FAILED) {
+                // Файл читается один раз от начала к концу: просим ядро читать вперед
+                // и не держать уже пройденные страницы
+                ::madvise(address, size, MADV_SEQUENTIAL);
+                view = static_cast<const char*>(address);
+                viewSize = size;
+            }
+        }
+        ::close(descriptor); // отображение остается действительным и после закрытия файла
+#else
+        (void)path;
+#endif
+    }
+
+    ~MappedFile() {
+#if defined(_WIN32)
+        if (view) {
+            UnmapViewOfFile(view);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#elif defined(MAPPED_FILE_POSIX)
+        if (view) {
+            ::munmap(const_cast<char*>(view), viewSize);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Файл отображен (пустой файл не отображается)
+    bool isMapped() const {
+        return view != nullptr;
+    }
+
+    const char* data() const {
+        return view;
+    }
+
+    size_t size() const {
+        return viewSize;
+    }
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,77 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Поразрядная сортировка LSD по 64-битному полю key
+// Каждый проход раскладывает элементы по корзинам устойчиво, поэтому итоговый
+// порядок равных ключей совпадает с исходным и сравнение по исходной позиции не нужно.
+// Ключ делится на разряды по RADIX_BITS бит; гистограммы всех разрядов строятся
+// за один просмотр, а проходы, в которых у всех ключей одинаковая цифра, пропускаются.
+// Элементы должны быть небольшими (ключ плюс ссылка на данные), так как каждый
+// проход копирует их целиком
+template <typename T>
+void radixSortByKey(std::vector<T>& items) {
+    constexpr unsigned RADIX_BITS = 11;
+    constexpr size_t BUCKETS = size_t(1) << RADIX_BITS;
+    constexpr uint64_t MASK = BUCKETS - 1;
+    constexpr unsigned PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+    const size_t count = items.size();
+    if (count < 2) {
+        return;
+    }
+
+    // Гистограммы цифр для всех проходов
+    std::vector<std::array<size_t, BUCKETS>> histograms(PASSES);
+    for (auto& histogram : histograms) {
+        histogram.fill(0);
+    }
+    for (const T& item : items) {
+        uint64_t key = item.key;
+        for (unsigned pass = 0; pass < PASSES; ++pass) {
+            histograms[pass][key & MASK]++;
+            key >>= RADIX_BITS;
+        }
+    }
+
+    std::vector<T> scratch(count);
+    T* source = items.data();
+    T* target = scratch.data();
+    bool inScratch = false;
+
+    for (unsigned pass = 0; pass < PASSES; ++pass) {
+        const unsigned shift = pass * RADIX_BITS;
+        auto& histogram = histograms[pass];
+
+        // Все ключи имеют одинаковую цифру в этом разряде - проход ничего не изменит
+        if (histogram[(source[0].key >> shift) & MASK] == count) {
+            continue;
+        }
+
+        // Превращаем счетчики в позиции начала корзин
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            const size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            target[histogram[(source[i].key >> shift) & MASK]++] = source[i];
+        }
+
+        std::swap(source, target);
+        inScratch = !inScratch;
+    }
+
+    if (inScratch) {
+        items.swap(scratch);
+    }
+}
+
+#endif // RADIX_SORT_H
@@ -0,0 +1,392 @@
+#ifndef RUN_FORMAT_H
+#define RUN_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "block_codec.h"
+#include "block_io.h"
+
+// Двоичный формат временных серий (.tempN)
+// ==========================================
+// Заголовок (8 байт):
+//   magic   | 4 байта "SBDR"
+//   version | uint16 little-endian, текущая версия RUN_FORMAT_VERSION
+//   flags   | uint16 little-endian, набор RUN_FLAG_*
+// Далее записи подряд до конца файла:
+//   key     | uint64 little-endian, 8 байт
+//   length  | длина значения, varint (LEB128)
+//   value   | length байт значения
+//   index   | исходная позиция строки, varint (только при RUN_FLAG_ORIGINAL_INDEX)
+//
+// Ключ и значение хранятся как есть, поэтому между проходами записи
+// не форматируются в текст и не разбираются заново
+//
+// При RUN_FLAG_COMPRESSED после заголовка идут независимые блоки:
+//   rawSize    | uint32 little-endian, размер распакованных записей блока
+//   storedSize | uint32 little-endian, размер данных блока в файле
+//   data       | записи, сжатые BlockCodec (или как есть, если storedSize == rawSize)
+// Внутри блока ключ записи хранится не целиком, а как varint-разность с предыдущим
+// ключом блока (у первой записи блока - с нулем): ключи серии отсортированы,
+// поэтому разности малы. Блок начинается с нуля, и читать серию можно с любого блока
+
+constexpr char RUN_MAGIC[4] = {'S', 'B', 'D', 'R'};
+constexpr uint16_t RUN_FORMAT_VERSION = 1;
+constexpr size_t RUN_HEADER_SIZE = 8;
+
+// Записи серии содержат исходную позицию строки во входном файле
+constexpr uint16_t RUN_FLAG_ORIGINAL_INDEX = 1 << 0;
+
+// Записи серии сжаты блоками
+constexpr uint16_t RUN_FLAG_COMPRESSED = 1 << 1;
+
+// Размер заголовка сжатого блока
+constexpr size_t RUN_BLOCK_HEADER_SIZE = 8;
+
+// Запись серии при чтении
+// Значение ссылается на буфер читателя и действительно до следующего вызова next()
+struct RunRecord {
+    uint64_t key = 0;           // ключ
+    std::string_view value;     // значение
+    uint64_t originalIndex = 0; // исходная позиция (если хранится в серии)
+};
+
+// Точка разреженного индекса серии
+struct RunSample {
+    uint64_t key = 0;       // ключ записи, с которой начинается точка
+    uint64_t offset = 0;    // смещение этой записи в файле серии
+    uint64_t textBytes = 0; // объем текстового результата "key:value\n" всех предыдущих записей
+};
+
+// Разреженный индекс серии, который собирается при ее записи
+// Точки идут по возрастанию ключа примерно через RunWriter::SAMPLE_INTERVAL байт,
+// поэтому по ним можно начать чтение серии с нужного ключа и заранее знать,
+// сколько байт результата займут пропущенные записи
+struct RunIndex {
+    std::vector<RunSample> samples; // точки индекса
+    uint64_t textBytes = 0;         // объем текстового результата всей серии
+    uint16_t flags = 0;             // флаги серии
+};
+
+// Последовательная запись серии в двоичном формате
+class RunWriter {
+private:
+    BlockWriter file;
+    uint16_t flags;
+    uint64_t position = RUN_HEADER_SIZE; // смещение следующей записи в файле
+    uint64_t nextSample = RUN_HEADER_SIZE; // смещение, начиная с которого ставится следующая точка
+    RunIndex index;
+    
+    // Сжатие блоками (только при RUN_FLAG_COMPRESSED)
+    std::vector<char> block;      // записи текущего блока до сжатия
+    std::vector<char> compressed; // сжатый блок
+    uint64_t previousKey = 0;     // ключ предыдущей записи блока
+    BlockCodec codec;
+    
+    // Сжимает и записывает накопленный блок
+    void flushBlock() {
+        if (block.empty()) {
+            return;
+        }
+        compressed.resize(RUN_BLOCK_HEADER_SIZE + block.size());
+        size_t stored = codec.compress(block.data(), block.size(), compressed.data() + RUN_BLOCK_HEADER_SIZE,
+                                       block.size() - 1);
+        if (stored == 0) {
+            stored = block.size(); // сжатие не помогло - храним как есть
+            std::memcpy(compressed.data() + RUN_BLOCK_HEADER_SIZE, block.data(), stored);
+        }
+        const uint32_t sizes[2] = {static_cast<uint32_t>(block.size()), static_cast<uint32_t>(stored)};
+        for (size_t i = 0; i < RUN_BLOCK_HEADER_SIZE; ++i) {
+            compressed[i] = static_cast<char>(sizes[i / 4] >> (8 * (i % 4)));
+        }
+        file.write(compressed.data(), RUN_BLOCK_HEADER_SIZE + stored);
+        position += RUN_BLOCK_HEADER_SIZE + stored;
+        block.clear();
+        previousKey = 0;
+    }
+    
+    // Добавляет запись в текущий сжимаемый блок
+    void writeCompressed(uint64_t key, std::string_view value, uint64_t originalIndex) {
+        char header[3 * MAX_VARINT_SIZE];
+        char* cursor = encodeVarint(header, key - previousKey);
+        cursor = encodeVarint(cursor, value.size());
+        block.insert(block.end(), header, cursor);
+        block.insert(block.end(), value.begin(), value.end());
+        if (flags & RUN_FLAG_ORIGINAL_INDEX) {
+            cursor = encodeVarint(header, originalIndex);
+            block.insert(block.end(), header, cursor);
+        }
+        previousKey = key;
+        if (block.size() >= COMPRESSED_BLOCK_SIZE) {
+            flushBlock();
+        }
+    }
+
+    // Записывает число в формате varint, возвращает указатель за последним байтом
+    static char* encodeVarint(char* cursor, uint64_t number) {
+        while (number >= 0x80) {
+            *cursor++ = static_cast<char>((number & 0x7F) | 0x80);
+            number >>= 7;
+        }
+        *cursor++ = static_cast<char>(number);
+        return cursor;
+    }
+
+public:
+    static constexpr size_t MAX_VARINT_SIZE = 10;
+    
+    // Расстояние между точками разреженного индекса в байтах серии
+    static constexpr uint64_t SAMPLE_INTERVAL = 64 * 1024;
+    
+    // Размер сжимаемого блока до сжатия
+    static constexpr size_t COMPRESSED_BLOCK_SIZE = 64 * 1024;
+
+    RunWriter(const std::string& path, uint16_t flags = 0)
+        : RunWriter(std::make_unique<FileSink>(path), IO_BLOCK_SIZE, flags) {}
+
+    RunWriter(std::unique_ptr<BlockSink> sink, size_t blockSize, uint16_t flags = 0)
+        : file(std::move(sink), blockSize), flags(flags) {
+        index.flags = flags;
+        char header[RUN_HEADER_SIZE] = {RUN_MAGIC[0], RUN_MAGIC[1], RUN_MAGIC[2], RUN_MAGIC[3],
+                                        static_cast<char>(RUN_FORMAT_VERSION & 0xFF),
+                                        static_cast<char>(RUN_FORMAT_VERSION >> 8),
+                                        static_cast<char>(flags & 0xFF),
+                                        static_cast<char>(flags >> 8)};
+        file.write(header, RUN_HEADER_SIZE);
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(file);
+    }
+
+    void write(uint64_t key, std::string_view value, uint64_t originalIndex = 0) {
+        // В сжатой серии читать можно только с начала блока, поэтому точки ставятся на блоки
+        const bool compressedRun = (flags & RUN_FLAG_COMPRESSED) != 0;
+        if (position >= nextSample && (!compressedRun || block.empty())) {
+            index.samples.push_back(RunSample{key, position, index.textBytes});
+            nextSample = position + (compressedRun ? 1 : SAMPLE_INTERVAL);
+        }
+        index.textBytes += BlockWriter::lineLength(key, value.size());
+        if (compressedRun) {
+            writeCompressed(key, value, originalIndex);
+            return;
+        }
+        
+        char* start = file.reserve(8 + MAX_VARINT_SIZE);
+        char* cursor = start;
+        for (int i = 0; i < 8; ++i) {
+            *cursor++ = static_cast<char>(key >> (8 * i));
+        }
+        cursor = encodeVarint(cursor, value.size());
+        file.commit(cursor - start);
+        file.write(value.data(), value.size());
+        position += (cursor - start) + value.size();
+        if (flags & RUN_FLAG_ORIGINAL_INDEX) {
+            start = file.reserve(MAX_VARINT_SIZE);
+            cursor = encodeVarint(start, originalIndex);
+            file.commit(cursor - start);
+            position += cursor - start;
+        }
+    }
+    
+    // Разреженный индекс записанной части серии
+    const RunIndex& getIndex() const {
+        return index;
+    }
+
+    // Завершает запись; возвращает false при ошибке ввода-вывода
+    bool close() {
+        flushBlock();
+        return file.close();
+    }
+};
+
+// Последовательное чтение серии в двоичном формате
+class RunReader {
+private:
+    BlockReader file;
+    uint16_t version = 0;
+    uint16_t flags = 0;
+    bool valid = false;   // заголовок прочитан и распознан
+    bool corrupt = false; // встречена оборванная или некорректная запись
+    
+    // Распакованный блок сжатой серии
+    std::vector<char> block;
+    size_t blockPosition = 0; // начало непрочитанных записей блока
+    uint64_t previousKey = 0; // ключ предыдущей записи блока
+
+    // Читает число в формате varint из памяти [cursor, end)
+    static bool decodeVarint(const char*& cursor, const char* end, uint64_t& number) {
+        number = 0;
+        for (size_t i = 0; cursor != end && i < RunWriter::MAX_VARINT_SIZE; ++i) {
+            const unsigned char byte = static_cast<unsigned char>(*cursor++);
+            number |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Читает и распаковывает следующий блок; false в конце серии или при ошибке
+    bool loadBlock() {
+        const size_t available = file.require(RUN_BLOCK_HEADER_SIZE);
+        if (available < RUN_BLOCK_HEADER_SIZE) {
+            corrupt = available != 0 || file.hasFailed(); // конец файла допустим только между блоками
+            return false;
+        }
+        const unsigned char* header = reinterpret_cast<const unsigned char*>(file.data());
+        uint32_t sizes[2] = {0, 0};
+        for (size_t i = 0; i < RUN_BLOCK_HEADER_SIZE; ++i) {
+            sizes[i / 4] |= static_cast<uint32_t>(header[i]) << (8 * (i % 4));
+        }
+        const size_t rawSize = sizes[0];
+        const size_t storedSize = sizes[1];
+        file.consume(RUN_BLOCK_HEADER_SIZE);
+        
+        block.resize(rawSize);
+        if (rawSize == 0 || storedSize > rawSize || file.require(storedSize) < storedSize) {
+            corrupt = true;
+            return false;
+        }
+        if (storedSize == rawSize) {
+            std::memcpy(block.data(), file.data(), rawSize);
+        } else if (!BlockCodec::decompress(file.data(), storedSize, block.data(), rawSize)) {
+            corrupt = true;
+            return false;
+        }
+        file.consume(storedSize);
+        blockPosition = 0;
+        previousKey = 0;
+        return true;
+    }
+    
+    // Читает следующую запись сжатой серии
+    bool nextCompressed(RunRecord& record) {
+        if (blockPosition == block.size() && !loadBlock()) {
+            return false;
+        }
+        const char* cursor = block.data() + blockPosition;
+        const char* end = block.data() + block.size();
+        uint64_t delta = 0;
+        uint64_t length = 0;
+        if (!decodeVarint(cursor, end, delta) || !decodeVarint(cursor, end, length) ||
+            length > static_cast<size_t>(end - cursor)) {
+            corrupt = true;
+            return false;
+        }
+        record.key = previousKey + delta;
+        record.value = std::string_view(cursor, length);
+        cursor += length;
+        if ((flags & RUN_FLAG_ORIGINAL_INDEX) && !decodeVarint(cursor, end, record.originalIndex)) {
+            corrupt = true;
+            return false;
+        }
+        previousKey = record.key;
+        blockPosition = cursor - block.data();
+        return true;
+    }
+
+    // Читает число в формате varint из буфера
+    bool readVarint(uint64_t& number) {
+        const size_t available = file.require(RunWriter::MAX_VARINT_SIZE);
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.data());
+        number = 0;
+        for (size_t i = 0; i < available && i < RunWriter::MAX_VARINT_SIZE; ++i) {
+            number |= static_cast<uint64_t>(bytes[i] & 0x7F) << (7 * i);
+            if ((bytes[i] & 0x80) == 0) {
+                file.consume(i + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit RunReader(const std::string& path, size_t blockSize = IO_BLOCK_SIZE)
+        : RunReader(std::make_unique<FileSource>(path), blockSize) {}
+
+    // Продолжает чтение серии с границы записи (например, с точки RunIndex):
+    // источник уже установлен на запись, а заголовок разобран ранее и дал flags
+    RunReader(std::unique_ptr<BlockSource> source, size_t blockSize, uint16_t flags)
+        : file(std::move(source), blockSize), version(RUN_FORMAT_VERSION), flags(flags) {
+        valid = static_cast<bool>(file);
+    }
+
+    RunReader(std::unique_ptr<BlockSource> source, size_t blockSize)
+        : file(std::move(source), blockSize) {
+        char header[RUN_HEADER_SIZE];
+        if (!file.read(header, RUN_HEADER_SIZE)) {
+            return;
+        }
+        version = static_cast<uint8_t>(header[4]) | (static_cast<uint8_t>(header[5]) << 8);
+        flags = static_cast<uint8_t>(header[6]) | (static_cast<uint8_t>(header[7]) << 8);
+        valid = std::string_view(header, 4) == std::string_view(RUN_MAGIC, 4) &&
+                version == RUN_FORMAT_VERSION;
+    }
+
+    // Файл открыт и имеет поддерживаемый формат
+    bool isValid() const {
+        return valid;
+    }
+
+    // При чтении встречена поврежденная запись или ошибка ввода-вывода
+    bool isCorrupt() const {
+        return corrupt;
+    }
+
+    uint16_t getVersion() const {
+        return version;
+    }
+
+    uint16_t getFlags() const {
+        return flags;
+    }
+
+    // Читает следующую запись; возвращает false в конце серии или при ошибке
+    bool next(RunRecord& record) {
+        if (!valid || corrupt) {
+            return false;
+        }
+        if (flags & RUN_FLAG_COMPRESSED) {
+            return nextCompressed(record);
+        }
+
+        const size_t available = file.require(8);
+        if (available < 8) {
+            corrupt = available != 0 || file.hasFailed(); // конец файла допустим только между записями
+            return false;
+        }
+        const unsigned char* keyBytes = reinterpret_cast<const unsigned char*>(file.data());
+        record.key = 0;
+        for (int i = 0; i < 8; ++i) {
+            record.key |= static_cast<uint64_t>(keyBytes[i]) << (8 * i);
+        }
+        file.consume(8);
+
+        // Вместе со значением подгружаем и следующий за ним индекс, чтобы его чтение
+        // не сдвинуло буфер под уже выданным представлением значения
+        const bool hasIndex = (flags & RUN_FLAG_ORIGINAL_INDEX) != 0;
+        uint64_t length = 0;
+        if (!readVarint(length) || length > SIZE_MAX - RunWriter::MAX_VARINT_SIZE ||
+            file.require(length + (hasIndex ? RunWriter::MAX_VARINT_SIZE : 0)) < length) {
+            corrupt = true;
+            return false;
+        }
+        record.value = std::string_view(file.data(), length);
+        file.consume(length);
+
+        if (hasIndex && !readVarint(record.originalIndex)) {
+            corrupt = true;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif // RUN_FORMAT_H
@@ -2,43 +2,231 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 #include <cstdint>
 #include <charconv>
 #include <system_error>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+#include <random>
+#include <csignal>
+#include <filesystem>
 
-// Структура для хранения пары ключ-значение и исходной позиции
-struct KeyValuePair {
-    uint64_t key;         // ключ
-    std::string value;    // значение
-    size_t originalIndex; // исходная позиция для обеспечения устойчивости сортировки
-};
+#include "bounded_queue.h"
+#include "loser_tree.h"
+#include "radix_sort.h"
+#include "block_io.h"
+#include "async_io.h"
+#include "run_format.h"
+#include "mapped_file.h"
+#include "sort_stats.h"
+#include "key_index.h"
+#include "checkpoint.h"
 
-// Функция для разбора строки на ключ и значение
-bool parseKeyValue(const std::string& line, KeyValuePair& pair) {
-    size_t colonPos = line.find(':');
-    if (colonPos == std::string::npos) {
+// Функция для разбора строки на ключ и значение, когда позиция двоеточия уже известна
+// (colon == line.size() - двоеточия нет)
+// Значение возвращается как представление части строки, без копирования
+bool parseKeyValue(std::string_view line, size_t colon, uint64_t& key, std::string_view& value) {
+    if (colon >= line.size()) {
         return false; // Не найдено двоеточие
     }
 
     // Попытка преобразовать ключ в uint64_t
-    const char* start = line.data();
-    const char* end = start + colonPos;
-    auto result = std::from_chars(start, end, pair.key);
-    if (result.ec != std::errc()) {
+    if (!parseKey(line.data(), line.data() + colon, key)) {
         return false; // Ошибка при преобразовании ключа
     }
 
-    // Извлечение значения
-    if (colonPos + 1 < line.size()) {
-        pair.value = line.substr(colonPos + 1);
-    } else {
-        pair.value = ""; // Пустое значение
+    // Извлечение значения (возможно пустого)
+    value = line.substr(colon + 1);
+    return true;
+}
+
+// Функция для разбора строки на ключ и значение
+bool parseKeyValue(std::string_view line, uint64_t& key, std::string_view& value) {
+    const char* colon = findByte(line.data(), line.data() + line.size(), ':');
+    return parseKeyValue(line, colon - line.data(), key, value);
+}
+
+// Запись пакета фиксированного размера: ключ и положение значения в арене пакета
+// Исходная позиция строки не хранится: записи лежат в пакете в порядке чтения,
+// а пакеты нумеруются в порядке следования во входном файле, поэтому для
+// устойчивости достаточно устойчивой сортировки внутри пакета и номера пакета при слиянии
+struct Record {
+    uint64_t key;    // ключ
+    uint32_t offset; // смещение значения в арене пакета
+    uint32_t length; // длина значения
+};
+
+// Пакет записей с общим буфером значений
+// Значения всех строк пакета лежат подряд в одной арене, поэтому разбор строки
+// не требует отдельного выделения памяти под каждую запись.
+// При чтении из отображенного файла значения не копируются: смещения записей
+// отсчитываются от base внутри отображения, а арена остается пустой
+struct RecordBatch {
+    size_t index = 0;            // номер пакета (он же номер временного файла)
+    std::vector<Record> records; // записи пакета
+    std::vector<char> arena;     // значения записей подряд
+    const char* base = nullptr;  // начало значений в отображении (режим без копирования)
+    size_t span = 0;             // объем отображения, занятый значениями пакета
+    InputCheckpoint end;         // место во входе сразу после пакета
+    
+    // Предельный объем арены, при котором смещения и длины помещаются в 32 бита
+    static constexpr size_t ARENA_LIMIT = size_t(1) << 31;
+    
+    // Значение записи
+    std::string_view value(const Record& record) const {
+        return std::string_view((base ? base : arena.data()) + record.offset, record.length);
     }
+    
+    void clear() {
+        records.clear();
+        arena.clear();
+        base = nullptr;
+        span = 0;
+    }
+    
+    // Оценка памяти пакета: емкость записей и арены плюс вспомогательный буфер
+    // сортировки (std::stable_sort и поразрядной), который выделяется по числу записей
+    size_t memoryBytes() const {
+        return (records.capacity() + records.size()) * sizeof(Record) + arena.capacity();
+    }
+    
+    // Проверяет, можно ли продолжать наполнять пакет
+    // Охват значений в отображении ограничен половиной ARENA_LIMIT, чтобы смещение
+    // следующей строки (с ключом любой длины) еще помещалось в 32 бита
+    bool hasRoom(size_t budget) const {
+        return memoryBytes() < budget && arena.size() < ARENA_LIMIT && span < ARENA_LIMIT / 2;
+    }
+    
+    // Добавляет запись, копируя значение в арену
+    // Буферы наращиваются вручную: не более чем вдвое и не более чем на половину
+    // остатка бюджета каждый, чтобы пакет не выходил за бюджет из-за удвоения емкости
+    bool append(uint64_t key, std::string_view value, size_t budget) {
+        if (value.size() >= ARENA_LIMIT) {
+            return false;
+        }
+        
+        const size_t used = memoryBytes();
+        const size_t half = used < budget ? (budget - used) / 2 : 0;
+        if (records.size() == records.capacity()) {
+            const size_t grown = std::max<size_t>(records.capacity(), 1024);
+            const size_t fits = half / (2 * sizeof(Record));
+            records.reserve(records.size() + std::max<size_t>(std::min(grown, fits), 1));
+        }
+        if (arena.size() + value.size() > arena.capacity()) {
+            const size_t grown = std::max<size_t>(arena.capacity(), 64 * 1024);
+            arena.reserve(arena.size() + std::max(std::min(grown, half), value.size()));
+        }
+        
+        records.push_back(Record{key, static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(value.size())});
+        arena.insert(arena.end(), value.begin(), value.end());
+        return true;
+    }
+    
+    // Добавляет запись, ссылаясь на значение в отображенном файле без копирования
+    // Значения пакета должны идти в отображении по возрастанию адресов
+    bool appendView(uint64_t key, std::string_view value, size_t budget) {
+        if (!base) {
+            base = value.data();
+        }
+        const size_t offset = value.data() - base;
+        if (offset >= ARENA_LIMIT || value.size() >= ARENA_LIMIT) {
+            return false;
+        }
+        
+        if (records.size() == records.capacity()) {
+            const size_t used = memoryBytes();
+            const size_t half = used < budget ? (budget - used) / 2 : 0;
+            const size_t grown = std::max<size_t>(records.capacity(), 1024);
+            const size_t fits = half / (2 * sizeof(Record));
+            records.reserve(records.size() + std::max<size_t>(std::min(grown, fits), 1));
+        }
+        
+        records.push_back(Record{key, static_cast<uint32_t>(offset), static_cast<uint32_t>(value.size())});
+        span = offset + value.size();
+        return true;
+    }
+};
 
-    return true;
+// Алгоритм сортировки пакета
+enum class SortAlgorithm {
+    Radix,  // поразрядная сортировка LSD по ключу
+    Stable  // std::stable_sort со сравнением ключей
+};
+
+// Способ формирования отсортированных серий
+enum class RunGeneration {
+    Batches,    // пакеты по бюджету памяти, сортируемые параллельно
+    Replacement // замещающий выбор через кучу в одном потоке
+};
+
+// Формат статистики, выводимой после сортировки
+enum class StatsFormat {
+    None, // не выводить
+    Text, // текстом для человека
+    Json  // одной строкой JSON
+};
+
+// Параметры запуска сортировщика
+struct SortOptions {
+    std::string inputPath;  // путь до исходного файла
+    std::string outputPath; // путь до файла результата
+    size_t threads = 0;     // количество потоков сортировки (0 - по числу ядер)
+    size_t memoryLimit = DEFAULT_MEMORY_LIMIT; // бюджет памяти на пакеты в байтах
+    SortAlgorithm algorithm = SortAlgorithm::Radix; // алгоритм сортировки пакетов
+    size_t maxFanIn = DEFAULT_MAX_FAN_IN;           // наибольшее число серий в проходе слияния
+    RunGeneration runGeneration = RunGeneration::Batches; // способ формирования серий
+    bool mapInput = false;  // читать вход через отображение в память
+    bool compressRuns = false; // сжимать временные серии
+    bool writeIndex = false;   // записать разреженный индекс результата <результат>.idx
+    bool resume = false;       // вести манифест и продолжить прерванный запуск по нему
+    StatsFormat statsFormat = StatsFormat::None; // вывод статистики после сортировки
+    size_t progressInterval = DEFAULT_PROGRESS_INTERVAL; // период вывода прогресса в секундах (0 - не выводить)
+    
+    // Бюджет памяти по умолчанию - 1 ГиБ
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = size_t(1) << 30;
+    
+    // Число серий в проходе слияния по умолчанию - с запасом ниже типичного ulimit -n = 1024
+    static constexpr size_t DEFAULT_MAX_FAN_IN = 512;
+    
+    // Прогресс выводится раз в 10 секунд: короткие запуски его не увидят
+    static constexpr size_t DEFAULT_PROGRESS_INTERVAL = 10;
+};
+
+// Имя входного или выходного файла, означающее stdin или stdout
+constexpr std::string_view STANDARD_STREAM = "-";
+
+// Основа имен временных файлов: путь результата, а при выводе в stdout -
+// случайное имя в текущем каталоге, чтобы параллельные конвейеры не пересекались
+static std::string tempFileBase(const std::string& outputPath) {
+    if (outputPath != STANDARD_STREAM) {
+        return outputPath;
+    }
+    std::random_device device;
+    const uint64_t salt = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return "sort_bigdatafile-" + std::to_string((static_cast<uint64_t>(device()) << 32 ^ device()) ^ salt);
+}
+
+// Размер файла в байтах или 0, если его не удалось определить
+static uint64_t fileSize(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    const std::streamoff size = file ? static_cast<std::streamoff>(file.tellg()) : std::streamoff(-1);
+    return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+
+// Время последнего изменения файла в тиках часов файловой системы или 0, если его не удалось определить
+static int64_t fileModificationTime(const std::string& path) {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
 }
 
 // Класс для пакетной обработки файла
@@ -46,221 +234,1302 @@ class FileSorter {
 private:
     const std::string inputPath;
     const std::string outputPath;
+    const std::string tempBase; // основа имен временных файлов
+    const size_t sorterThreads; // количество потоков сортировки пакетов
+    const size_t memoryLimit;   // общий бюджет памяти на пакеты в байтах
+    const SortAlgorithm algorithm; // алгоритм сортировки пакетов
+    const size_t maxFanIn;      // наибольшее число серий в одном проходе слияния
+    const RunGeneration runGeneration; // способ формирования серий
+    const bool mapInput;        // читать вход через отображение в память
+    const bool compressRuns;    // сжимать временные серии
+    const bool writeIndex;      // записать разреженный индекс результата
+    const bool resume;          // вести манифест контрольных точек и продолжать по нему
+    const std::chrono::seconds progressInterval; // период вывода прогресса (0 - не выводить)
     
-    // Максимальное количество строк для обработки за раз
-    static constexpr size_t BATCH_SIZE = 1000000;
+    // Разреженные индексы записанных серий по их номерам
+    // Заполняются потоком записи серий, поэтому защищены мьютексом
+    mutable std::mutex indexMutex;
+    std::unordered_map<size_t, RunIndex> runIndexes;
+    
+    // Статистика по фазам; счетчики атомарны и пополняются из разных потоков
+    mutable SortStats stats;
+    
+    // Манифест контрольных точек (только с --resume) и смещение входа, с которого
+    // продолжается формирование серий
+    std::unique_ptr<CheckpointManifest> manifest;
+    uint64_t inputOffset = 0;
+    
+    // Сколько некорректных строк выводится, прежде чем они только подсчитываются
+    static constexpr uint64_t MALFORMED_WARNINGS = 10;
+    
+    // Количество пакетов, одновременно находящихся в конвейере формирования серий:
+    // заполняемый читателем, sorterThreads в очереди на сортировку, sorterThreads
+    // в сортировщиках, один в очереди на запись и один у потока записи
+    size_t batchesInFlight() const {
+        return 2 * sorterThreads + 3;
+    }
+    
+    // Бюджет памяти одного пакета
+    size_t batchBudget() const {
+        return std::max<size_t>(memoryLimit / batchesInFlight(), 1);
+    }
+    
+    // Размер блока ввода-вывода при слиянии, когда бюджет памяти делят streams потоков
+    size_t mergeBlockSize(size_t streams) const {
+        constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+        return std::clamp(memoryLimit / std::max<size_t>(streams, 1), MIN_BLOCK_SIZE, IO_BLOCK_SIZE);
+    }
+    
+    // Флаги формата создаваемых временных серий
+    uint16_t runFlags() const {
+        return compressRuns ? RUN_FLAG_COMPRESSED : 0;
+    }
     
     // Создает временный файл и возвращает его имя
     std::string createTempFile(size_t index) const {
-        return outputPath + ".temp" + std::to_string(index);
+        return tempBase + ".temp" + std::to_string(index);
+    }
+    
+    // Открывает приемник результата: файл или stdout
+    std::unique_ptr<BlockSink> createOutputSink() const {
+        if (outputPath == STANDARD_STREAM) {
+            return std::make_unique<StdoutSink>();
+        }
+        return std::make_unique<FileSink>(outputPath);
     }
     
-    // Сортирует часть файла и записывает во временный файл
-    bool sortBatch(std::ifstream& input, size_t batchIndex, size_t& linesProcessed) {
-        std::vector<KeyValuePair> batch;
-        batch.reserve(BATCH_SIZE);
+    // Записывает индекс результата размером outputSize байт, если он включен
+    bool storeOutputIndex(const std::vector<KeyIndexEntry>& entries, uint64_t outputSize) const {
+        if (!writeIndex) {
+            return true;
+        }
+        const std::string indexPath = outputPath + ".idx";
+        if (!writeKeyIndex(indexPath, entries, outputSize)) {
+            std::cerr << "Ошибка записи индекса результата " << indexPath << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // Сообщает о некорректной строке: первые MALFORMED_WARNINGS выводятся целиком,
+    // остальные только подсчитываются, чтобы не сбрасывать std::cerr на каждой строке
+    void reportMalformed(std::string_view line) const {
+        const uint64_t count = ++stats.malformedLines;
+        if (count <= MALFORMED_WARNINGS) {
+            std::cerr << "Предупреждение: невозможно разобрать строку: " << line << '\n';
+        } else if (count == MALFORMED_WARNINGS + 1) {
+            std::cerr << "Предупреждение: дальнейшие некорректные строки только подсчитываются\n";
+        }
+    }
+    
+    // Читает из входного файла очередной пакет строк
+    // Возвращает false, если входной файл исчерпан и пакет пуст
+    // Пакет заполняется, пока оценка занятой им памяти не достигнет budget
+    bool readBatch(BlockReader& input, RecordBatch& batch, size_t budget) {
+        PhaseTimer timer(stats.parseNanos);
+        batch.clear();
         
-        // Чтение строк из входного файла
-        std::string line;
-        size_t lineIndex = 0;
-        while (batch.size() < BATCH_SIZE && std::getline(input, line)) {
-            KeyValuePair pair;
-            pair.originalIndex = linesProcessed + lineIndex;
-            
-            if (parseKeyValue(line, pair)) {
-                batch.push_back(std::move(pair));
-            } else {
-                std::cerr << "Предупреждение: невозможно разобрать строку: " << line << std::endl;
+        // Строки отображенного файла живут до конца сортировки - значения не копируем
+        const bool views = input.hasStableViews();
+        std::string_view line;
+        size_t colon;
+        uint64_t key;
+        std::string_view value;
+        while (batch.hasRoom(budget) && input.nextLine(line, colon)) {
+            const bool appended = parseKeyValue(line, colon, key, value) &&
+                                  (views ? batch.appendView(key, value, budget) : batch.append(key, value, budget));
+            if (!appended) {
+                reportMalformed(line);
             }
-            lineIndex++;
         }
         
-        if (batch.empty()) {
-            return false; // Нет данных для обработки
+        stats.linesParsed += batch.records.size();
+        stats.inputBytes = inputOffset + input.position();
+        batch.end = InputCheckpoint{stats.inputBytes, stats.linesParsed};
+        return !batch.records.empty();
+    }
+    
+    // Устойчиво сортирует пакет по ключу выбранным алгоритмом
+    void sortBatch(RecordBatch& batch) const {
+        PhaseTimer timer(stats.sortNanos);
+        ++stats.batchesSorted;
+        if (algorithm == SortAlgorithm::Radix) {
+            radixSortByKey(batch.records);
+            return;
         }
-        
-        // Устойчивая сортировка по ключу
-        std::stable_sort(batch.begin(), batch.end(), 
-                         [](const KeyValuePair& a, const KeyValuePair& b) {
+        std::stable_sort(batch.records.begin(), batch.records.end(), 
+                         [](const Record& a, const Record& b) {
                              return a.key < b.key;
                          });
-        
-        // Запись отсортированного пакета во временный файл
-        const std::string tempFile = createTempFile(batchIndex);
-        std::ofstream output(tempFile);
+    }
+    
+    // Записывает отсортированный пакет во временный файл
+    bool writeBatch(const RecordBatch& batch) {
+        PhaseTimer timer(stats.runWriteNanos);
+        const std::string tempFile = createTempFile(batch.index);
+        RunWriter output(tempFile, runFlags());
         if (!output) {
             std::cerr << "Ошибка: не удалось создать временный файл " << tempFile << std::endl;
             return false;
         }
         
-        for (const auto& pair : batch) {
-            output << pair.key << ":" << pair.value << "\n";
+        for (const auto& record : batch.records) {
+            output.write(record.key, batch.value(record));
         }
         
-        linesProcessed += lineIndex;
+        if (!output.close()) {
+            std::cerr << "Ошибка записи временного файла " << tempFile << std::endl;
+            return false;
+        }
+        storeRunIndex(batch.index, output);
+        if (manifest) {
+            manifest->recordRun(batch.index, batch.end);
+        }
         return true;
     }
     
-    // Объединяет все временные файлы в итоговый
-    bool mergeTempFiles(size_t tempFileCount) {
-        if (tempFileCount == 0) {
+    // Размер входного файла в байтах или 0, если его не удалось определить (в том числе для stdin)
+    uint64_t inputSize() const {
+        return inputPath == STANDARD_STREAM ? 0 : fileSize(inputPath);
+    }
+    
+    // Вход, скорее всего, поместится в один пакет на весь бюджет памяти
+    // Пакет занимает примерно столько же, сколько текст значений, плюс по две записи
+    // на строку, поэтому берем запас в два раза; ошибка оценки лишь отменяет быстрый путь
+    bool fitsInMemory() const {
+        return inputSize() <= memoryLimit / 2;
+    }
+    
+    // Записывает отсортированный пакет сразу в файл результата
+    bool writeOutput(const RecordBatch& batch) const {
+        PhaseTimer timer(stats.finalMergeNanos);
+        BlockWriter output(std::make_unique<WriteBehindSink>(createOutputSink(), IO_BLOCK_SIZE), IO_BLOCK_SIZE);
+        if (!output) {
+            std::cerr << "Ошибка: не удалось создать файл результата " << outputPath << std::endl;
             return false;
         }
         
-        // Если только один временный файл, просто переименовываем его
-        if (tempFileCount == 1) {
-            std::string tempFile = createTempFile(0);
-            std::ifstream input(tempFile, std::ios::binary);
-            std::ofstream output(outputPath, std::ios::binary);
-            
-            if (!input || !output) {
-                std::cerr << "Ошибка при переименовании единственного временного файла" << std::endl;
+        KeyIndexBuilder index;
+        for (const auto& record : batch.records) {
+            const std::string_view value = batch.value(record);
+            if (writeIndex) {
+                index.add(record.key, BlockWriter::lineLength(record.key, value.size()));
+            }
+            output.writeLine(record.key, value);
+        }
+        
+        if (!output.close()) {
+            std::cerr << "Ошибка записи файла результата " << outputPath << std::endl;
+            return false;
+        }
+        return storeOutputIndex(index.getEntries(), index.getPosition());
+    }
+    
+    // Сортирует вход целиком в памяти, минуя временные файлы
+    // Читает один пакет на весь бюджет памяти; если вход исчерпан, пакет сортируется
+    // и сразу пишется в результат (done = true). Иначе пакет становится первой серией,
+    // а формирование серий продолжается обычным способом с остатка входа
+    bool sortInMemory(BlockReader& input, size_t& tempFileCount, bool& done) {
+        RecordBatch batch;
+        readBatch(input, batch, memoryLimit);
+        if (input.hasFailed()) {
+            std::cerr << "Ошибка чтения входного файла " << inputPath << std::endl;
+            return false;
+        }
+        
+        sortBatch(batch);
+        done = input.require(1) == 0 && !input.hasFailed();
+        if (done) {
+            stats.inMemory = true;
+            stats.enterPhase(SortPhase::FinalMerge);
+            const bool written = writeOutput(batch);
+            stats.outputBytes = stats.writtenInPhase();
+            return written;
+        }
+        
+        batch.index = tempFileCount++;
+        return writeBatch(batch);
+    }
+    
+    // Формирует отсортированные временные файлы конвейером
+    // Поток чтения разбивает вход на пакеты, sorterThreads потоков сортируют их,
+    // а поток записи сбрасывает готовые пакеты на диск. Между стадиями стоят
+    // очереди ограниченной емкости, поэтому в памяти одновременно находится
+    // не более batchesInFlight() пакетов, а чтение, сортировка и запись идут параллельно
+    bool generateRuns(BlockReader& input, size_t& tempFileCount) {
+        BoundedQueue<RecordBatch> sortQueue(sorterThreads);
+        BoundedQueue<RecordBatch> writeQueue(1);
+        std::atomic<bool> failed(false);
+        
+        std::vector<std::thread> sorters;
+        sorters.reserve(sorterThreads);
+        for (size_t i = 0; i < sorterThreads; ++i) {
+            sorters.emplace_back([this, &sortQueue, &writeQueue] {
+                while (std::optional<RecordBatch> batch = sortQueue.pop()) {
+                    sortBatch(*batch);
+                    writeQueue.push(std::move(*batch));
+                }
+            });
+        }
+        
+        // Поток записи разбирает очередь до конца даже после ошибки,
+        // чтобы не заблокировать сортировщики
+        std::thread writer([this, &writeQueue, &failed] {
+            while (std::optional<RecordBatch> batch = writeQueue.pop()) {
+                if (!failed && !writeBatch(*batch)) {
+                    failed = true;
+                }
+            }
+        });
+        
+        RecordBatch batch;
+        while (!failed && readBatch(input, batch, batchBudget())) {
+            batch.index = tempFileCount++;
+            sortQueue.push(std::move(batch));
+            batch = RecordBatch();
+        }
+        
+        sortQueue.close();
+        for (auto& sorter : sorters) {
+            sorter.join();
+        }
+        writeQueue.close();
+        writer.join();
+        
+        if (input.hasFailed()) {
+            std::cerr << "Ошибка чтения входного файла " << inputPath << std::endl;
+            return false;
+        }
+        return !failed;
+    }
+    
+    // Формирует серии методом замещающего выбора
+    // Записи хранятся в куче, упорядоченной по (номер серии, ключ, исходная позиция).
+    // Наименьшая запись текущей серии уходит на диск, а на ее место читается новая:
+    // если ее ключ не меньше только что записанного, она еще успевает в текущую серию,
+    // иначе откладывается в следующую. На случайных данных серии получаются примерно
+    // вдвое больше бюджета памяти, а почти упорядоченный вход дает одну серию.
+    // Равные ключи из разных серий идут в порядке номеров серий, а внутри серии
+    // упорядочиваются исходной позицией, поэтому устойчивость сохраняется
+    bool generateRunsReplacement(BlockReader& input, size_t& tempFileCount) {
+        struct HeapEntry {
+            size_t run;           // номер серии, в которую попадет запись
+            uint64_t key;         // ключ
+            uint64_t originalIndex; // исходная позиция строки
+            size_t slot;          // ячейка со значением
+        };
+        // std::push_heap строит кучу с наибольшим элементом наверху, поэтому сравнение обратное
+        auto later = [](const HeapEntry& a, const HeapEntry& b) {
+            if (a.run != b.run) {
+                return a.run > b.run;
+            }
+            if (a.key != b.key) {
+                return a.key > b.key;
+            }
+            return a.originalIndex > b.originalIndex;
+        };
+        
+        // Значения лежат в переиспользуемых ячейках, чтобы не выделять память на каждую запись
+        std::vector<HeapEntry> heap;
+        std::vector<std::string> values;
+        std::vector<size_t> freeSlots;
+        const size_t inlineCapacity = std::string().capacity();
+        size_t valueBytes = 0; // динамическая память значений сверх внутреннего буфера std::string
+        auto slotBytes = [inlineCapacity](const std::string& value) {
+            return value.capacity() > inlineCapacity ? value.capacity() + 1 : 0;
+        };
+        auto estimate = [&] {
+            return heap.size() * sizeof(HeapEntry) + values.size() * (sizeof(std::string) + sizeof(size_t)) +
+                   valueBytes;
+        };
+        
+        // Кладет строку в кучу; false - строка некорректна
+        uint64_t linesRead = 0;
+        size_t currentRun = 0;
+        uint64_t lastKey = 0;
+        bool runStarted = false;
+        auto pushLine = [&](std::string_view line) {
+            const uint64_t originalIndex = linesRead++;
+            uint64_t key;
+            std::string_view value;
+            if (!parseKeyValue(line, key, value)) {
                 return false;
             }
+            ++stats.linesParsed;
+            size_t slot;
+            if (freeSlots.empty()) {
+                slot = values.size();
+                values.emplace_back();
+            } else {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            valueBytes -= slotBytes(values[slot]);
+            values[slot].assign(value.data(), value.size());
+            valueBytes += slotBytes(values[slot]);
             
-            output << input.rdbuf();
-            input.close();
-            output.close();
-            std::remove(tempFile.c_str());
+            const size_t run = (!runStarted || key >= lastKey) ? currentRun : currentRun + 1;
+            heap.push_back(HeapEntry{run, key, originalIndex, slot});
+            std::push_heap(heap.begin(), heap.end(), later);
             return true;
-        }
+        };
         
-        // Структура для многопутевого слияния
-        struct FileEntry {
-            std::ifstream file;
-            KeyValuePair currentPair;
-            bool hasNext;
-            
-            FileEntry(const std::string& path) : file(path), hasNext(false) {
-                readNext();
+        // Потребляет из кучи лишь часть бюджета: остальное приходится на буферы ввода-вывода
+        const size_t budget = std::max<size_t>(memoryLimit > 4 * IO_BLOCK_SIZE ? memoryLimit - 4 * IO_BLOCK_SIZE
+                                                                               : memoryLimit / 2, 1);
+        std::unique_ptr<RunWriter> output;
+        std::string_view line;
+        bool inputLeft = true;
+        
+        while (true) {
+            // Дочитываем вход, пока куча помещается в бюджет
+            while (inputLeft && (heap.empty() || estimate() < budget)) {
+                if (!input.nextLine(line)) {
+                    inputLeft = false;
+                } else if (!pushLine(line)) {
+                    reportMalformed(line);
+                }
+                stats.inputBytes = inputOffset + input.position();
+            }
+            if (heap.empty()) {
+                break;
             }
             
-            void readNext() {
-                std::string line;
-                if (std::getline(file, line)) {
-                    if (parseKeyValue(line, currentPair)) {
-                        hasNext = true;
-                    } else {
-                        readNext(); // Пропускаем некорректные строки
-                    }
-                } else {
-                    hasNext = false;
+            std::pop_heap(heap.begin(), heap.end(), later);
+            const HeapEntry entry = heap.back();
+            heap.pop_back();
+            
+            // Запись следующей серии наверху кучи - текущая серия закончилась
+            if (!output || entry.run != currentRun) {
+                if (output && !output->close()) {
+                    std::cerr << "Ошибка записи временного файла " << createTempFile(tempFileCount - 1) << std::endl;
+                    return false;
+                }
+                if (output) {
+                    storeRunIndex(tempFileCount - 1, *output);
+                }
+                currentRun = entry.run;
+                const std::string tempFile = createTempFile(tempFileCount++);
+                output = std::make_unique<RunWriter>(
+                    std::make_unique<WriteBehindSink>(std::make_unique<FileSink>(tempFile), IO_BLOCK_SIZE),
+                    IO_BLOCK_SIZE, runFlags());
+                if (!*output) {
+                    std::cerr << "Ошибка: не удалось создать временный файл " << tempFile << std::endl;
+                    return false;
                 }
             }
-        };
+            
+            output->write(entry.key, values[entry.slot]);
+            lastKey = entry.key;
+            runStarted = true;
+            freeSlots.push_back(entry.slot);
+            // Пока куча не помещается в бюджет, память освободившихся значений возвращаем сразу
+            if (estimate() >= budget) {
+                valueBytes -= slotBytes(values[entry.slot]);
+                std::string().swap(values[entry.slot]);
+            }
+        }
         
-        // Открываем все временные файлы
-        std::vector<FileEntry> files;
-        files.reserve(tempFileCount);
+        if (output && !output->close()) {
+            std::cerr << "Ошибка записи временного файла " << createTempFile(tempFileCount - 1) << std::endl;
+            return false;
+        }
+        if (output) {
+            storeRunIndex(tempFileCount - 1, *output);
+        }
+        if (input.hasFailed()) {
+            std::cerr << "Ошибка чтения входного файла " << inputPath << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // Удаляет временные файлы перечисленных серий
+    void removeRuns(const std::vector<size_t>& runs) {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        for (size_t run : runs) {
+            std::remove(createTempFile(run).c_str());
+            if (manifest) {
+                std::remove((createTempFile(run) + ".idx").c_str());
+            }
+            runIndexes.erase(run);
+        }
+    }
+    
+    // Наибольшее число серий, сливаемых за один проход
+    // Бюджет памяти делится так, чтобы каждой серии досталось два буфера
+    // по MERGE_READ_BLOCK_SIZE (плюс пара буферов у результата слияния),
+    // а сверху число серий ограничено --max-fan-in (и тем самым числом открытых файлов)
+    size_t mergeFanIn() const {
+        constexpr size_t MERGE_READ_BLOCK_SIZE = size_t(1) << 20;
+        const size_t byBudget = memoryLimit / (2 * MERGE_READ_BLOCK_SIZE);
+        return std::max<size_t>(std::min(byBudget > 0 ? byBudget - 1 : 0, maxFanIn), 2);
+    }
+    
+    // Читаемая при слиянии серия с текущей записью
+    struct MergeInput {
+        RunReader reader;
+        RunRecord current;
+        bool hasNext = false;
         
-        for (size_t i = 0; i < tempFileCount; ++i) {
-            files.emplace_back(createTempFile(i));
-            if (!files.back().file) {
-                std::cerr << "Ошибка: не удалось открыть временный файл " << createTempFile(i) << std::endl;
+        // Открывает серию path с границы записи offset через фоновое чтение io
+        MergeInput(const std::string& path, uint64_t offset, uint16_t flags, IoThread& io, size_t blockSize)
+            : reader(openRun(path, offset, flags, io, blockSize)) {
+            readNext();
+        }
+        
+        // С начала серии читаем и проверяем заголовок, с середины - доверяем флагам индекса
+        static RunReader openRun(const std::string& path, uint64_t offset, uint16_t flags, IoThread& io,
+                                 size_t blockSize) {
+            if (offset <= RUN_HEADER_SIZE) {
+                return RunReader(std::make_unique<PrefetchSource>(std::make_unique<FileSource>(path), io, blockSize),
+                                 blockSize);
+            }
+            return RunReader(
+                std::make_unique<PrefetchSource>(std::make_unique<FileSource>(path, offset), io, blockSize),
+                blockSize, flags);
+        }
+        
+        void readNext() {
+            hasNext = reader.next(current);
+        }
+    };
+    
+    // Запоминает разреженный индекс записанной серии
+    // С манифестом индекс сохраняется и рядом с серией, чтобы пережить перезапуск
+    void storeRunIndex(size_t run, const RunWriter& writer) {
+        if (manifest && !writeRunIndexFile(createTempFile(run) + ".idx", writer.getIndex())) {
+            std::cerr << "Предупреждение: не удалось сохранить индекс серии " << createTempFile(run) << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(indexMutex);
+        runIndexes[run] = writer.getIndex();
+    }
+    
+    // Разреженный индекс серии (пустой, если серия записана без него)
+    const RunIndex& findRunIndex(size_t run) const {
+        static const RunIndex empty;
+        std::lock_guard<std::mutex> lock(indexMutex);
+        const auto found = runIndexes.find(run);
+        return found != runIndexes.end() ? found->second : empty;
+    }
+    
+    // Открывает серии group так, чтобы первой в каждой была запись с ключом не меньше low
+    // Чтение начинается с последней точки индекса, ключ которой меньше low, а оставшиеся
+    // меньшие ключи пропускаются. В textBefore возвращается объем текстового результата
+    // всех пропущенных записей, то есть смещение диапазона в файле результата
+    bool openInputs(const std::vector<size_t>& group, size_t blockSize, IoThread& io, uint64_t low,
+                    std::vector<MergeInput>& inputs, uint64_t& textBefore) {
+        inputs.reserve(group.size());
+        textBefore = 0;
+        for (size_t run : group) {
+            const RunIndex& index = findRunIndex(run);
+            uint64_t offset = RUN_HEADER_SIZE;
+            const auto after = std::lower_bound(index.samples.begin(), index.samples.end(), low,
+                                                [](const RunSample& sample, uint64_t key) {
+                                                    return sample.key < key;
+                                                });
+            if (after != index.samples.begin()) {
+                offset = std::prev(after)->offset;
+                textBefore += std::prev(after)->textBytes;
+            }
+            
+            inputs.emplace_back(createTempFile(run), offset, index.flags, io, blockSize);
+            MergeInput& input = inputs.back();
+            if (!input.reader.isValid()) {
+                std::cerr << "Ошибка: не удалось открыть временный файл " << createTempFile(run) << std::endl;
                 return false;
             }
+            while (input.hasNext && input.current.key < low) {
+                textBefore += BlockWriter::lineLength(input.current.key, input.current.value.size());
+                input.readNext();
+            }
+        }
+        return true;
+    }
+    
+    // Сливает открытые серии и передает записи в emit в порядке возрастания ключа,
+    // пока не встретится ключ high (если bounded) или серии не кончатся
+    // Серии перечислены в порядке следования их данных во входном файле,
+    // поэтому при равных ключах раньше идет запись из серии, стоящей в group раньше
+    // Возвращает false, если какая-либо серия повреждена
+    template <typename Emit>
+    bool mergeInputs(const std::vector<size_t>& group, std::vector<MergeInput>& files, bool bounded, uint64_t high,
+                     Emit emit) {
+        auto active = [bounded, high](const MergeInput& input) {
+            return input.hasNext && (!bounded || input.current.key < high);
+        };
+        
+        // Выполняем многопутевое слияние через дерево проигравших
+        auto beats = [&files, &active](size_t a, size_t b) {
+            const MergeInput& first = files[a];
+            const MergeInput& second = files[b];
+            if (!active(first) || !active(second)) {
+                return active(first);
+            }
+            if (first.current.key != second.current.key) {
+                return first.current.key < second.current.key;
+            }
+            return a < b;
+        };
+        LoserTree<decltype(beats)> tree(files.size(), beats);
+        
+        while (active(files[tree.top()])) {
+            MergeInput& minEntry = files[tree.top()];
+            
+            // Передаем минимальную запись дальше
+            emit(minEntry.current.key, minEntry.current.value);
+            
+            // Читаем следующую запись из этого файла и переигрываем турнир
+            minEntry.readNext();
+            tree.replay();
+        }
+        
+        bool succeeded = true;
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (files[i].reader.isCorrupt()) {
+                std::cerr << "Ошибка: поврежден временный файл " << createTempFile(group[i]) << std::endl;
+                succeeded = false;
+            }
+        }
+        return succeeded;
+    }
+    
+    // Сливает серии group целиком и передает записи в emit
+    // Возвращает false, если серию не удалось открыть или она повреждена
+    template <typename Emit>
+    bool mergeRuns(const std::vector<size_t>& group, size_t blockSize, Emit emit) {
+        IoThread io(group.size());
+        std::vector<MergeInput> files;
+        uint64_t textBefore = 0;
+        if (!openInputs(group, blockSize, io, 0, files, textBefore)) {
+            return false;
+        }
+        return mergeInputs(group, files, false, 0, emit);
+    }
+    
+    // Сливает группу серий в новую промежуточную серию с номером target
+    bool mergeIntoRun(const std::vector<size_t>& group, size_t target) {
+        const size_t blockSize = mergeBlockSize(2 * group.size() + 2);
+        const std::string tempFile = createTempFile(target);
+        RunWriter output(std::make_unique<WriteBehindSink>(std::make_unique<FileSink>(tempFile), blockSize),
+                         blockSize, runFlags());
+        if (!output) {
+            std::cerr << "Ошибка: не удалось создать временный файл " << tempFile << std::endl;
+            return false;
         }
         
-        // Открываем выходной файл
-        std::ofstream output(outputPath);
+        bool succeeded = mergeRuns(group, blockSize, [&output](uint64_t key, std::string_view value) {
+            output.write(key, value);
+        });
+        if (!output.close() && succeeded) {
+            std::cerr << "Ошибка записи временного файла " << tempFile << std::endl;
+            succeeded = false;
+        }
+        storeRunIndex(target, output);
+        return succeeded;
+    }
+    
+    // Сливает серии в файл результата в одном потоке
+    bool mergeIntoOutput(const std::vector<size_t>& runs) {
+        const size_t blockSize = mergeBlockSize(2 * runs.size() + 2);
+        BlockWriter output(std::make_unique<WriteBehindSink>(createOutputSink(), blockSize), blockSize);
         if (!output) {
             std::cerr << "Ошибка: не удалось создать файл результата " << outputPath << std::endl;
             return false;
         }
         
-        // Выполняем многопутевое слияние
-        while (true) {
-            // Находим файл с минимальным следующим ключом
-            size_t minIndex = 0;
-            bool foundValid = false;
-            
-            for (size_t i = 0; i < files.size(); ++i) {
-                if (files[i].hasNext) {
-                    if (!foundValid || 
-                        (files[i].currentPair.key < files[minIndex].currentPair.key) ||
-                        (files[i].currentPair.key == files[minIndex].currentPair.key && 
-                         files[i].currentPair.originalIndex < files[minIndex].currentPair.originalIndex)) {
-                        minIndex = i;
-                        foundValid = true;
-                    }
-                }
+        KeyIndexBuilder index;
+        bool succeeded = mergeRuns(runs, blockSize, [this, &output, &index](uint64_t key, std::string_view value) {
+            if (writeIndex) {
+                index.add(key, BlockWriter::lineLength(key, value.size()));
             }
-            
-            if (!foundValid) {
-                break; // Все файлы обработаны
+            output.writeLine(key, value);
+        });
+        if (!output.close() && succeeded) {
+            std::cerr << "Ошибка записи файла результата " << outputPath << std::endl;
+            succeeded = false;
+        }
+        return succeeded && storeOutputIndex(index.getEntries(), index.getPosition());
+    }
+    
+    // Выбирает до parts - 1 возрастающих границ диапазонов ключей для параллельного слияния
+    // Точки индексов всех серий отстоят друг от друга на равный объем данных,
+    // поэтому их квантили по ключу делят результат на части примерно равного размера.
+    // Нулевая граница дала бы пустой диапазон и не используется
+    std::vector<uint64_t> chooseSplitters(const std::vector<size_t>& runs, size_t parts) const {
+        std::vector<uint64_t> keys;
+        for (size_t run : runs) {
+            for (const RunSample& sample : findRunIndex(run).samples) {
+                keys.push_back(sample.key);
             }
+        }
+        std::sort(keys.begin(), keys.end());
+        
+        std::vector<uint64_t> splitters;
+        for (size_t part = 1; part < parts && !keys.empty(); ++part) {
+            const uint64_t key = keys[part * keys.size() / parts];
+            if (key > 0 && (splitters.empty() || key > splitters.back())) {
+                splitters.push_back(key);
+            }
+        }
+        return splitters;
+    }
+    
+    // Сливает записи серий с ключами из [low, high) в файл результата с его заранее
+    // вычисленного смещения (все ключи от low, если bounded = false); точки индекса
+    // результата для этого диапазона собираются в index
+    bool mergeRangeIntoOutput(const std::vector<size_t>& runs, size_t blockSize, uint64_t low, bool bounded,
+                              uint64_t high, KeyIndexBuilder& index) {
+        IoThread io(runs.size());
+        std::vector<MergeInput> files;
+        uint64_t offset = 0;
+        if (!openInputs(runs, blockSize, io, low, files, offset)) {
+            return false;
+        }
+        
+        BlockWriter output(
+            std::make_unique<WriteBehindSink>(std::make_unique<FileSink>(outputPath, offset), blockSize), blockSize);
+        if (!output) {
+            std::cerr << "Ошибка: не удалось открыть файл результата " << outputPath << std::endl;
+            return false;
+        }
+        
+        index = KeyIndexBuilder(offset);
+        auto emit = [this, &output, &index](uint64_t key, std::string_view value) {
+            if (writeIndex) {
+                index.add(key, BlockWriter::lineLength(key, value.size()));
+            }
+            output.writeLine(key, value);
+        };
+        bool succeeded = mergeInputs(runs, files, bounded, high, emit);
+        if (!output.close() && succeeded) {
+            std::cerr << "Ошибка записи файла результата " << outputPath << std::endl;
+            succeeded = false;
+        }
+        return succeeded;
+    }
+    
+    // Сливает серии в файл результата параллельно по диапазонам ключей
+    // Каждый поток сливает свой диапазон [splitters[i-1], splitters[i]) из всех серий
+    // и пишет его прямо на место в файле результата: смещение равно объему текста всех
+    // меньших ключей и вычисляется по индексам серий. Равные ключи всегда попадают
+    // в один диапазон, поэтому результат побайтно совпадает с последовательным слиянием
+    bool mergeIntoOutputParallel(const std::vector<size_t>& runs, const std::vector<uint64_t>& splitters) {
+        {
+            FileSink output(outputPath);
+            if (!output.isOpen() || !output.close()) {
+                std::cerr << "Ошибка: не удалось создать файл результата " << outputPath << std::endl;
+                return false;
+            }
+        }
+        
+        const size_t parts = splitters.size() + 1;
+        const size_t blockSize = mergeBlockSize(parts * (2 * runs.size() + 2));
+        std::atomic<bool> failed(false);
+        std::vector<KeyIndexBuilder> indexes(parts);
+        std::vector<std::thread> workers;
+        workers.reserve(parts);
+        for (size_t part = 0; part < parts; ++part) {
+            const uint64_t low = part == 0 ? 0 : splitters[part - 1];
+            const bool bounded = part + 1 < parts;
+            const uint64_t high = bounded ? splitters[part] : 0;
+            workers.emplace_back([this, &runs, &failed, &indexes, part, blockSize, low, bounded, high] {
+                if (!mergeRangeIntoOutput(runs, blockSize, low, bounded, high, indexes[part])) {
+                    failed = true;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (failed) {
+            return false;
+        }
+        
+        // Диапазоны идут подряд, поэтому их точки складываются в общий индекс по порядку
+        std::vector<KeyIndexEntry> entries;
+        for (const KeyIndexBuilder& index : indexes) {
+            entries.insert(entries.end(), index.getEntries().begin(), index.getEntries().end());
+        }
+        return storeOutputIndex(entries, indexes.back().getPosition());
+    }
+    
+    // Объединяет все временные файлы в итоговый
+    // Если серий больше, чем mergeFanIn(), они сливаются в несколько проходов:
+    // соседние серии объединяются группами в более крупные промежуточные серии,
+    // пока их число не станет допустимым для последнего прохода. Группы состоят
+    // из соседних серий, поэтому порядок серий во входном файле и устойчивость сохраняются
+    bool mergeTempFiles(std::vector<size_t> runs, size_t nextRun) {
+        if (runs.empty()) {
+            return false;
+        }
+        
+        const size_t fanIn = mergeFanIn();
+        if (runs.size() > fanIn) {
+            stats.enterPhase(SortPhase::IntermediateMerge);
+        }
+        while (runs.size() > fanIn) {
+            ++stats.currentPass;
+            // Делим серии на равные по числу группы, чтобы проходов было как можно меньше
+            const size_t groupCount = (runs.size() + fanIn - 1) / fanIn;
+            const size_t groupSize = (runs.size() + groupCount - 1) / groupCount;
             
-            // Записываем минимальную пару в выходной файл
-            output << files[minIndex].currentPair.key << ":" << files[minIndex].currentPair.value << "\n";
-            
-            // Читаем следующую запись из этого файла
-            files[minIndex].readNext();
+            std::vector<size_t> merged;
+            for (size_t start = 0; start < runs.size(); start += groupSize) {
+                const size_t finish = std::min(start + groupSize, runs.size());
+                std::vector<size_t> group(runs.begin() + start, runs.begin() + finish);
+                if (group.size() == 1) {
+                    merged.push_back(group.front());
+                    continue;
+                }
+                
+                const size_t target = nextRun++;
+                PhaseTimer timer(stats.intermediateMergeNanos);
+                ++stats.intermediateRuns;
+                if (!mergeIntoRun(group, target)) {
+                    removeRuns(merged);
+                    removeRuns(std::vector<size_t>(runs.begin() + start, runs.end()));
+                    removeRuns({target});
+                    return false;
+                }
+                if (manifest) {
+                    manifest->recordMerge(target, group);
+                }
+                removeRuns(group);
+                merged.push_back(target);
+            }
+            runs = std::move(merged);
+            ++stats.mergePasses;
+            stats.intermediateBytes = stats.writtenInPhase();
         }
         
-        // Закрываем все файлы и удаляем временные
-        output.close();
-        for (size_t i = 0; i < tempFileCount; ++i) {
-            std::string tempFile = createTempFile(i);
-            files[i].file.close();
-            std::remove(tempFile.c_str());
+        // Последний проход пишет текстовый результат, при нескольких потоках - параллельно;
+        // stdout нельзя писать с произвольного смещения, поэтому в него сливаем в одном потоке
+        uint64_t outputTarget = 0;
+        for (size_t run : runs) {
+            outputTarget += findRunIndex(run).textBytes;
         }
+        stats.outputTarget = outputTarget;
+        stats.enterPhase(SortPhase::FinalMerge);
+        ++stats.currentPass;
+        bool succeeded;
+        {
+            PhaseTimer timer(stats.finalMergeNanos);
+            const std::vector<uint64_t> splitters =
+                sorterThreads > 1 && outputPath != STANDARD_STREAM ? chooseSplitters(runs, sorterThreads)
+                                                                   : std::vector<uint64_t>();
+            succeeded = splitters.empty() ? mergeIntoOutput(runs) : mergeIntoOutputParallel(runs, splitters);
+        }
+        ++stats.mergePasses;
+        stats.outputBytes = stats.writtenInPhase();
         
-        return true;
+        // Удаляем временные файлы
+        removeRuns(runs);
+        return succeeded;
     }
 
 public:
-    FileSorter(const std::string& input, const std::string& output)
-        : inputPath(input), outputPath(output) {}
+    explicit FileSorter(const SortOptions& options)
+        : inputPath(options.inputPath),
+          outputPath(options.outputPath),
+          tempBase(tempFileBase(options.outputPath)),
+          sorterThreads(options.threads > 0 ? options.threads
+                                            : std::max(1u, std::thread::hardware_concurrency())),
+          memoryLimit(options.memoryLimit),
+          algorithm(options.algorithm),
+          maxFanIn(options.maxFanIn),
+          runGeneration(options.runGeneration),
+          mapInput(options.mapInput),
+          compressRuns(options.compressRuns),
+          writeIndex(options.writeIndex),
+          resume(options.resume),
+          progressInterval(options.progressInterval) {}
+
+    // Сливает серии в результат и завершает сортировку
+    bool finishMerge(std::vector<size_t> runs, size_t nextRun) {
+        const bool merged = mergeTempFiles(std::move(runs), nextRun);
+        stats.phase = SortPhase::Done;
+        if (merged && manifest) {
+            manifest->remove();
+        }
+        return merged;
+    }
+    
+    // Восстанавливает по манифесту состояние прерванного запуска с тем же входом
+    // Если серии уже сформированы, в runs попадает их список после записанных слияний.
+    // Иначе остаются начальные серии до первой недостающей (серии пишутся не строго
+    // по порядку), и формирование продолжится с конца последней из них; для замещающего
+    // выбора так нельзя, ведь его серии не соответствуют участкам входа.
+    // Файлы серий, не вошедших в список, удаляются. Возвращает false, если продолжать
+    // нечего (тогда state пусто и сортировка идет с начала)
+    bool restoreCheckpoint(CheckpointState& state, std::vector<size_t>& runs, size_t& nextRun) {
+        runs.clear();
+        if (!manifest->load(state)) {
+            state = CheckpointState();
+            return false;
+        }
+        
+        // Наибольший номер серии, файл которой мог остаться: известные серии
+        // и пакеты, которые в момент остановки еще были в конвейере
+        size_t lastRun = state.runs.empty() ? 0 : state.runs.rbegin()->first;
+        lastRun = std::max(lastRun, state.runCount);
+        for (const auto& merge : state.merges) {
+            lastRun = std::max(lastRun, merge.first);
+        }
+        lastRun += batchesInFlight();
+        
+        if (state.generated) {
+            for (size_t run = 0; run < state.runCount; ++run) {
+                runs.push_back(run);
+            }
+            for (const auto& [target, group] : state.merges) {
+                auto first = std::find(runs.begin(), runs.end(), group.front());
+                if (first == runs.end() || static_cast<size_t>(runs.end() - first) < group.size() ||
+                    !std::equal(group.begin(), group.end(), first)) {
+                    runs.clear();
+                    break;
+                }
+                *first = target;
+                runs.erase(first + 1, first + group.size());
+            }
+        } else if (runGeneration == RunGeneration::Batches) {
+            size_t prefix = 0;
+            while (state.runs.count(prefix) != 0) {
+                ++prefix;
+            }
+            state.runs.erase(state.runs.lower_bound(prefix), state.runs.end());
+            for (size_t run = 0; run < prefix; ++run) {
+                runs.push_back(run);
+            }
+        }
+        
+        // Серии из списка должны быть на месте вместе с индексами
+        bool complete = !runs.empty();
+        for (size_t run : runs) {
+            RunIndex index;
+            if (!complete || !std::ifstream(createTempFile(run)) ||
+                !readRunIndexFile(createTempFile(run) + ".idx", index) || index.flags != runFlags()) {
+                complete = false;
+                break;
+            }
+            std::lock_guard<std::mutex> lock(indexMutex);
+            runIndexes[run] = std::move(index);
+        }
+        if (!complete) {
+            runs.clear();
+            runIndexes.clear();
+        }
+        
+        std::vector<bool> live(lastRun + 1, false);
+        for (size_t run : runs) {
+            live[run] = true;
+        }
+        std::vector<size_t> obsolete;
+        for (size_t run = 0; run <= lastRun; ++run) {
+            if (!live[run]) {
+                obsolete.push_back(run);
+            }
+        }
+        removeRuns(obsolete);
+        
+        if (!complete) {
+            if (!state.runs.empty() || state.generated) {
+                std::cerr << "Предупреждение: временные файлы из манифеста не найдены, сортировка начинается сначала"
+                          << std::endl;
+            }
+            state = CheckpointState();
+            return false;
+        }
+        
+        nextRun = *std::max_element(runs.begin(), runs.end()) + 1;
+        if (state.generated) {
+            stats.linesParsed = state.end.lines;
+            stats.inputBytes = state.end.inputEnd;
+            std::cerr << "Продолжение по манифесту: серии сформированы, к слиянию " << runs.size() << std::endl;
+        } else {
+            const InputCheckpoint& last = state.runs.rbegin()->second;
+            inputOffset = last.inputEnd;
+            stats.linesParsed = last.lines;
+            std::cerr << "Продолжение по манифесту: готово серий " << runs.size() << ", вход продолжается с байта "
+                      << inputOffset << std::endl;
+        }
+        return true;
+    }
+    
+    // Статистика последней сортировки
+    const SortStats& getStats() const {
+        return stats;
+    }
 
     bool sort() {
-        std::ifstream input(inputPath);
+        // Продолжение прерванного запуска: восстанавливаем серии по манифесту
+        // и начинаем новый манифест с восстановленного состояния
+        CheckpointState checkpoint;
+        std::vector<size_t> restoredRuns;
+        size_t nextRun = 0;
+        bool resumed = false;
+        if (resume) {
+            manifest = std::make_unique<CheckpointManifest>(tempBase + ".manifest", inputPath, inputSize(),
+                                                            fileModificationTime(inputPath), runFlags(), static_cast<int>(runGeneration));
+            resumed = restoreCheckpoint(checkpoint, restoredRuns, nextRun);
+            if (!manifest->create(checkpoint)) {
+                std::cerr << "Ошибка: не удалось создать манифест " << tempBase << ".manifest" << std::endl;
+                return false;
+            }
+        }
+        
+        stats.inputSize = inputSize();
+        stats.threads = sorterThreads;
+        stats.memoryLimit = memoryLimit;
+        stats.batchBudget = batchBudget();
+        stats.fanIn = mergeFanIn();
+        stats.enterPhase(SortPhase::RunGeneration);
+        ProgressReporter progress(stats, progressInterval);
+        
+        // Серии уже сформированы - остается слияние
+        if (resumed && checkpoint.generated) {
+            stats.runs = checkpoint.runCount;
+            return finishMerge(std::move(restoredRuns), nextRun);
+        }
+        
+        // Отображение живет до конца сортировки: пакеты ссылаются на его строки
+        // stdin читается потоком: отображать нечего; его размер заранее неизвестен, поэтому
+        // сначала он читается в память одним пакетом и серии появляются, только если бюджета не хватило
+        const bool fromStdin = inputPath == STANDARD_STREAM;
+        std::unique_ptr<MappedFile> mapping;
+        if (mapInput && fromStdin) {
+            std::cerr << "Предупреждение: stdin нельзя отобразить в память, используется потоковое чтение" << std::endl;
+        } else if (mapInput) {
+            mapping = std::make_unique<MappedFile>(inputPath);
+            if (!mapping->isMapped() && inputSize() > 0) {
+                std::cerr << "Предупреждение: отображение входного файла недоступно, используется потоковое чтение" << std::endl;
+            }
+        }
+        const bool mapped = mapping && mapping->isMapped() && inputOffset <= mapping->size();
+        BlockReader input = mapped ? BlockReader(mapping->data() + inputOffset, mapping->size() - inputOffset)
+                            : fromStdin ? BlockReader(std::make_unique<StdinSource>(), IO_BLOCK_SIZE)
+                                        : BlockReader(std::make_unique<FileSource>(inputPath, inputOffset), IO_BLOCK_SIZE);
         if (!input) {
             std::cerr << "Ошибка: не удалось открыть входной файл " << inputPath << std::endl;
             return false;
         }
+        if (mapped) {
+            // Отображенный файл читается без FileSource - учитываем его целиком
+            IoCounters::global().bytesRead += mapping->size() - inputOffset;
+        }
         
-        size_t tempFileCount = 0;
-        size_t linesProcessed = 0;
+        // Небольшой вход сортируем в памяти и пишем сразу в результат
+        size_t tempFileCount = restoredRuns.size();
+        bool generated = true;
+        if (!resumed && fitsInMemory()) {
+            bool done = false;
+            generated = sortInMemory(input, tempFileCount, done);
+            if (generated && done) {
+                stats.phase = SortPhase::Done;
+                if (manifest) {
+                    manifest->remove();
+                }
+                return true;
+            }
+        }
         
         // Обрабатываем файл по частям
-        while (sortBatch(input, tempFileCount, linesProcessed)) {
-            tempFileCount++;
+        if (generated) {
+            PhaseTimer timer(stats.runGenerationNanos);
+            generated = runGeneration == RunGeneration::Replacement
+                            ? generateRunsReplacement(input, tempFileCount)
+                            : generateRuns(input, tempFileCount);
         }
+        stats.inputBytes = inputOffset + input.position();
+        stats.runs = tempFileCount;
+        stats.runBytes = stats.writtenInPhase();
         
-        input.close();
+        std::vector<size_t> runs(tempFileCount);
+        for (size_t i = 0; i < tempFileCount; ++i) {
+            runs[i] = i;
+        }
+        if (!generated) {
+            removeRuns(runs);
+            return false;
+        }
+        if (manifest) {
+            manifest->recordGenerated(tempFileCount, InputCheckpoint{stats.inputBytes, stats.linesParsed});
+        }
         
         // Если не было создано временных файлов, значит входной файл пуст
         if (tempFileCount == 0) {
-            std::ofstream output(outputPath);
-            if (!output) {
+            std::unique_ptr<BlockSink> output = createOutputSink();
+            if (!output->isOpen() || !output->close()) {
                 std::cerr << "Ошибка: не удалось создать файл результата " << outputPath << std::endl;
                 return false;
             }
-            output.close();
-            return true;
+            if (manifest) {
+                manifest->remove();
+            }
+            return storeOutputIndex({}, 0);
         }
         
         // Объединяем временные файлы
-        return mergeTempFiles(tempFileCount);
+        return finishMerge(std::move(runs), tempFileCount);
     }
 };
 
+// Разбирает числовое значение опции вида --name=<число>
+static bool parseCount(const std::string& text, size_t& value) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Разбирает объем памяти с необязательным суффиксом K, M, G или T (степени 1024)
+static bool parseMemorySize(const std::string& text, size_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    
+    size_t shift = 0;
+    std::string digits = text;
+    switch (text.back()) {
+        case 'K': case 'k': shift = 10; break;
+        case 'M': case 'm': shift = 20; break;
+        case 'G': case 'g': shift = 30; break;
+        case 'T': case 't': shift = 40; break;
+        default: break;
+    }
+    if (shift != 0) {
+        digits.pop_back();
+    }
+    
+    size_t number = 0;
+    if (!parseCount(digits, number) || number == 0 || number > (SIZE_MAX >> shift)) {
+        return false;
+    }
+    value = number << shift;
+    return true;
+}
+
+// Выводит справку по использованию программы
+static void printUsage(const char* programName) {
+    std::cerr << "Использование: " << programName << " [опции] <входной_файл> <выходной_файл>" << std::endl;
+    std::cerr << "       (- вместо имени файла - stdin или stdout)" << std::endl;
+    std::cerr << "       " << programName << " --dump-run <временный_файл>" << std::endl;
+    std::cerr << "       " << programName << " --lookup <файл_результата> <ключ>|<от>-<до>" << std::endl;
+    std::cerr << "Опции:" << std::endl;
+    std::cerr << "  --threads=<N>         количество потоков сортировки (по умолчанию - по числу ядер)" << std::endl;
+    std::cerr << "  --memory-limit=<size> бюджет памяти на пакеты, например 512M или 4G (по умолчанию 1G)" << std::endl;
+    std::cerr << "  --algo=radix|stable   алгоритм сортировки пакетов (по умолчанию radix)" << std::endl;
+    std::cerr << "  --max-fan-in=<N>      наибольшее число серий в проходе слияния (по умолчанию 512)" << std::endl;
+    std::cerr << "  --runs=batch|replacement способ формирования серий: пакеты или замещающий выбор" << std::endl;
+    std::cerr << "  --mmap                читать вход через отображение в память без копирования значений" << std::endl;
+    std::cerr << "  --compress-runs       сжимать временные серии (разности ключей и блочный кодек)" << std::endl;
+    std::cerr << "  --resume              вести манифест контрольных точек и продолжить прерванный запуск" << std::endl;
+    std::cerr << "  --index               записать разреженный индекс результата <выходной_файл>.idx" << std::endl;
+    std::cerr << "  --stats[=text|json]   вывести время и скорость фаз, объем ввода-вывода, число серий и пиковую память" << std::endl;
+    std::cerr << "  --progress=<сек>      период вывода прогресса в stderr (по умолчанию 10, 0 - не выводить)" << std::endl;
+}
+
+// Разбирает аргументы командной строки
+static bool parseArguments(int argc, char* argv[], SortOptions& options) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) {
+            if (!parseCount(arg.substr(10), options.threads) || options.threads == 0) {
+                std::cerr << "Ошибка: некорректное количество потоков: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg.rfind("--memory-limit=", 0) == 0) {
+            if (!parseMemorySize(arg.substr(15), options.memoryLimit)) {
+                std::cerr << "Ошибка: некорректный бюджет памяти: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg.rfind("--max-fan-in=", 0) == 0) {
+            if (!parseCount(arg.substr(13), options.maxFanIn) || options.maxFanIn < 2) {
+                std::cerr << "Ошибка: некорректное число серий в проходе слияния: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg == "--runs=batch") {
+            options.runGeneration = RunGeneration::Batches;
+        } else if (arg == "--runs=replacement") {
+            options.runGeneration = RunGeneration::Replacement;
+        } else if (arg == "--mmap") {
+            options.mapInput = true;
+        } else if (arg == "--compress-runs") {
+            options.compressRuns = true;
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--index") {
+            options.writeIndex = true;
+        } else if (arg == "--stats" || arg == "--stats=text") {
+            options.statsFormat = StatsFormat::Text;
+        } else if (arg == "--stats=json") {
+            options.statsFormat = StatsFormat::Json;
+        } else if (arg.rfind("--progress=", 0) == 0) {
+            if (!parseCount(arg.substr(11), options.progressInterval)) {
+                std::cerr << "Ошибка: некорректный период вывода прогресса: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg == "--algo=radix") {
+            options.algorithm = SortAlgorithm::Radix;
+        } else if (arg == "--algo=stable") {
+            options.algorithm = SortAlgorithm::Stable;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Ошибка: неизвестная опция " << arg << std::endl;
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    
+    if (positional.size() != 2) {
+        return false;
+    }
+    options.inputPath = positional[0];
+    options.outputPath = positional[1];
+    if (options.resume && (options.inputPath == STANDARD_STREAM || options.outputPath == STANDARD_STREAM)) {
+        std::cerr << "Ошибка: --resume требует входной и выходной файлы, а не stdin или stdout" << std::endl;
+        return false;
+    }
+    if (options.writeIndex && options.outputPath == STANDARD_STREAM) {
+        std::cerr << "Ошибка: индекс --index нельзя построить для результата в stdout" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Выводит содержимое временной серии в текстовом виде для отладки
+static int dumpRun(const std::string& path) {
+    RunReader reader(path);
+    if (!reader.isValid()) {
+        std::cerr << "Ошибка: " << path << " не является временной серией поддерживаемой версии" << std::endl;
+        return 1;
+    }
+    
+    std::cerr << "Серия " << path << ": версия " << reader.getVersion()
+              << ", флаги " << reader.getFlags() << std::endl;
+    
+    const bool hasIndex = (reader.getFlags() & RUN_FLAG_ORIGINAL_INDEX) != 0;
+    RunRecord record;
+    while (reader.next(record)) {
+        std::cout << record.key << ":" << record.value;
+        if (hasIndex) {
+            std::cout << "\t#" << record.originalIndex;
+        }
+        std::cout << "\n";
+    }
+    
+    if (reader.isCorrupt()) {
+        std::cerr << "Ошибка: серия " << path << " повреждена" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Разбирает ключ <key> или диапазон ключей <lo>-<hi> (границы включаются)
+static bool parseKeyRange(const std::string& text, uint64_t& low, uint64_t& high) {
+    auto parse = [](std::string_view part, uint64_t& key) {
+        auto result = std::from_chars(part.data(), part.data() + part.size(), key);
+        return result.ec == std::errc() && result.ptr == part.data() + part.size();
+    };
+    const size_t dash = text.find('-');
+    if (dash == std::string::npos) {
+        if (!parse(text, low)) {
+            return false;
+        }
+        high = low;
+        return true;
+    }
+    const std::string_view view(text);
+    return parse(view.substr(0, dash), low) && parse(view.substr(dash + 1), high) && low <= high;
+}
+
+// Выводит строки отсортированного файла с ключами из диапазона range
+// По индексу <файл>.idx чтение начинается с последней точки перед диапазоном и
+// заканчивается на первом ключе за ним; без индекса файл просматривается с начала
+static int lookupKeys(const std::string& path, const std::string& range) {
+    uint64_t low = 0;
+    uint64_t high = 0;
+    if (!parseKeyRange(range, low, high)) {
+        std::cerr << "Ошибка: некорректный ключ или диапазон ключей: " << range << std::endl;
+        return 1;
+    }
+    
+    const std::string indexPath = path + ".idx";
+    uint64_t offset = 0;
+    KeyIndex index;
+    if (!index.load(indexPath)) {
+        std::cerr << "Предупреждение: индекс " << indexPath << " недоступен, файл просматривается с начала" << std::endl;
+    } else if (index.getOutputSize() != fileSize(path)) {
+        std::cerr << "Предупреждение: индекс " << indexPath << " не соответствует файлу, файл просматривается с начала"
+                  << std::endl;
+    } else {
+        offset = index.startOffset(low);
+    }
+    
+    BlockReader input(std::make_unique<FileSource>(path, offset), KeyIndexBuilder::INTERVAL);
+    if (!input) {
+        std::cerr << "Ошибка: не удалось открыть файл " << path << std::endl;
+        return 1;
+    }
+    
+    std::string_view line;
+    uint64_t key;
+    std::string_view value;
+    while (input.nextLine(line)) {
+        if (!parseKeyValue(line, key, value) || key < low) {
+            continue;
+        }
+        if (key > high) {
+            break;
+        }
+        std::cout << line << '\n';
+    }
+    std::cout.flush();
+    
+    if (input.hasFailed()) {
+        std::cerr << "Ошибка чтения файла " << path << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    // Режим просмотра временной серии
+    if (argc == 3 && std::string(argv[1]) == "--dump-run") {
+        return dumpRun(argv[2]);
+    }
+    
+    // Режим поиска по отсортированному файлу
+    if (argc == 4 && std::string(argv[1]) == "--lookup") {
+        return lookupKeys(argv[2], argv[3]);
+    }
+    
     // Проверка аргументов командной строки
-    if (argc != 3) {
-        std::cerr << "Использование: " << argv[0] << " <входной_файл> <выходной_файл>" << std::endl;
+    SortOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    std::string inputPath = argv[1];
-    std::string outputPath = argv[2];
+#ifdef SIGPIPE
+    // Если читатель stdout закрыл канал раньше времени, запись должна завершиться ошибкой,
+    // а не сигналом: тогда временные файлы успевают удалиться
+    if (options.outputPath == STANDARD_STREAM) {
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+#endif
 
     // Запускаем таймер
     auto startTime = std::chrono::high_resolution_clock::now();
     
     // Создаем и запускаем сортировщик
-    FileSorter sorter(inputPath, outputPath);
-    if (!sorter.sort()) {
+    FileSorter sorter(options);
+    const bool sorted = sorter.sort();
+    if (sorter.getStats().malformedLines > 0) {
+        std::cerr << "Предупреждение: пропущено некорректных строк: " << sorter.getStats().malformedLines << std::endl;
+    }
+    if (!sorted) {
         std::cerr << "Ошибка при сортировке файла" << std::endl;
         return 1;
     }
@@ -269,8 +1538,21 @@ int main(int argc, char* argv[]) {
     auto endTime = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
 
-    std::cout << "Сортировка завершена успешно. Результат сохранен в " << outputPath << std::endl;
-    std::cout << "Время выполнения: " << duration.count() << " мс" << std::endl;
+    // Если результат ушел в stdout, сообщения не должны смешиваться с ним
+    std::ostream& report = options.outputPath == STANDARD_STREAM ? std::cerr : std::cout;
+    if (options.outputPath == STANDARD_STREAM) {
+        report << "Сортировка завершена успешно. Результат выведен в stdout" << std::endl;
+    } else {
+        report << "Сортировка завершена успешно. Результат сохранен в " << options.outputPath << std::endl;
+    }
+    report << "Время выполнения: " << duration.count() << " мс" << std::endl;
+    const uint64_t bytesRead = IoCounters::global().bytesRead;
+    const uint64_t bytesWritten = IoCounters::global().bytesWritten;
+    if (options.statsFormat == StatsFormat::Text) {
+        printStats(report, sorter.getStats(), bytesRead, bytesWritten);
+    } else if (options.statsFormat == StatsFormat::Json) {
+        printStatsJson(report, sorter.getStats(), bytesRead, bytesWritten, duration.count());
+    }
     
     return 0;
 }
@@ -0,0 +1,269 @@
+#ifndef SORT_STATS_H
+#define SORT_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "block_io.h"
+
+// Текущая фаза сортировки
+enum class SortPhase {
+    RunGeneration,     // разбор входа и формирование серий
+    IntermediateMerge, // промежуточные проходы слияния
+    FinalMerge,        // последний проход и запись результата
+    Done               // сортировка завершена
+};
+
+inline const char* phaseName(SortPhase phase) {
+    switch (phase) {
+        case SortPhase::RunGeneration: return "формирование серий";
+        case SortPhase::IntermediateMerge: return "промежуточное слияние";
+        case SortPhase::FinalMerge: return "последнее слияние";
+        case SortPhase::Done:
+        default: return "завершение";
+    }
+}
+
+// Статистика работы сортировщика по фазам
+// Время фаз, выполняемых несколькими потоками (сортировка, запись серий),
+// суммируется по потокам, поэтому может превышать общее время работы.
+// Счетчики читаются потоком вывода прогресса во время сортировки
+struct SortStats {
+    std::atomic<uint64_t> parseNanos{0};             // разбор входа в пакеты
+    std::atomic<uint64_t> sortNanos{0};              // сортировка пакетов
+    std::atomic<uint64_t> runWriteNanos{0};          // запись начальных серий
+    std::atomic<uint64_t> runGenerationNanos{0};     // формирование серий целиком (по часам)
+    std::atomic<uint64_t> intermediateMergeNanos{0}; // промежуточные проходы слияния
+    std::atomic<uint64_t> finalMergeNanos{0};        // последний проход (запись результата)
+    std::atomic<uint64_t> inputBytes{0};             // разобрано байт входа
+    std::atomic<uint64_t> linesParsed{0};            // принято строк
+    std::atomic<uint64_t> malformedLines{0};         // пропущено некорректных строк
+    std::atomic<uint64_t> batchesSorted{0};          // отсортировано пакетов
+    std::atomic<uint64_t> runs{0};                   // начальных серий
+    std::atomic<uint64_t> intermediateRuns{0};       // промежуточных серий
+    std::atomic<uint64_t> mergePasses{0};            // проходов слияния, включая последний
+    std::atomic<uint64_t> runBytes{0};               // записано байт при формировании серий
+    std::atomic<uint64_t> intermediateBytes{0};      // записано байт промежуточными проходами
+    std::atomic<uint64_t> outputBytes{0};            // записано байт результата
+    std::atomic<SortPhase> phase{SortPhase::RunGeneration};
+    std::atomic<uint64_t> currentPass{0};            // номер текущего прохода слияния с 1
+    std::atomic<uint64_t> phaseStartWritten{0};      // IoCounters::bytesWritten в начале фазы
+    std::atomic<uint64_t> outputTarget{0};           // ожидаемый размер результата, 0 - неизвестен
+    uint64_t inputSize = 0;                          // размер входного файла, 0 - неизвестен
+    bool inMemory = false;                           // вход отсортирован в памяти без серий
+
+    // Параметры запуска, от которых зависят результаты
+    size_t threads = 0;
+    size_t memoryLimit = 0;
+    size_t batchBudget = 0;
+    size_t fanIn = 0;
+
+    // Переходит к фазе next, запоминая объем уже записанных данных
+    void enterPhase(SortPhase next) {
+        phaseStartWritten = IoCounters::global().bytesWritten.load();
+        phase = next;
+    }
+
+    // Объем, записанный с начала текущей фазы
+    uint64_t writtenInPhase() const {
+        return IoCounters::global().bytesWritten.load() - phaseStartWritten.load();
+    }
+};
+
+// Добавляет к счетчику время жизни объекта в наносекундах
+class PhaseTimer {
+private:
+    std::atomic<uint64_t>& target;
+    const std::chrono::steady_clock::time_point start;
+
+public:
+    explicit PhaseTimer(std::atomic<uint64_t>& target) : target(target), start(std::chrono::steady_clock::now()) {}
+
+    ~PhaseTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        target += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+// Пиковый объем резидентной памяти процесса в байтах или 0, если он неизвестен
+// Значение берется из /proc/self/status (Linux) обычным чтением файла
+inline uint64_t peakMemoryBytes() {
+    std::ifstream status("/proc/self/status");
+    std::string name;
+    while (status >> name) {
+        if (name == "VmHWM:") {
+            uint64_t kilobytes = 0;
+            status >> kilobytes;
+            return kilobytes * 1024;
+        }
+        status.ignore(4096, '\n');
+    }
+    return 0;
+}
+
+// Скорость в МиБ/с для bytes байт за nanos наносекунд
+inline uint64_t mebibytesPerSecond(uint64_t bytes, uint64_t nanos) {
+    return nanos > 0 ? static_cast<uint64_t>(static_cast<double>(bytes) * 1e9 / nanos / (1024 * 1024)) : 0;
+}
+
+// Периодически выводит в std::cerr строку о ходе сортировки
+// Поток вывода только читает атомарные счетчики и не замедляет сортировку
+class ProgressReporter {
+private:
+    const SortStats& stats;
+    const std::chrono::seconds interval;
+    std::mutex mutex;
+    std::condition_variable stopped;
+    bool stopping = false;
+    std::thread thread;
+
+    void run() {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point start = Clock::now();
+        Clock::time_point last = start;
+        uint64_t lastRead = IoCounters::global().bytesRead;
+        uint64_t lastWritten = IoCounters::global().bytesWritten;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopped.wait_for(lock, interval, [this] { return stopping; })) {
+            const Clock::time_point now = Clock::now();
+            const uint64_t read = IoCounters::global().bytesRead;
+            const uint64_t written = IoCounters::global().bytesWritten;
+            const uint64_t nanos = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+            const SortPhase phase = stats.phase;
+
+            std::string line = "Прогресс [" +
+                               std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now - start).count()) +
+                               " с] " + phaseName(phase);
+            if (phase == SortPhase::RunGeneration) {
+                line += ": строк " + std::to_string(stats.linesParsed.load()) + ", " +
+                        std::to_string(stats.inputBytes.load() >> 20) + " МиБ";
+                if (stats.inputSize > 0) {
+                    line += " из " + std::to_string(stats.inputSize >> 20) + " МиБ (" +
+                            std::to_string(stats.inputBytes.load() * 100 / stats.inputSize) + "%)";
+                }
+                line += ", пакетов " + std::to_string(stats.batchesSorted.load()) + ", пропущено строк " +
+                        std::to_string(stats.malformedLines.load());
+            } else {
+                line += ", проход " + std::to_string(stats.currentPass.load()) + ": записано " +
+                        std::to_string(stats.writtenInPhase() >> 20) + " МиБ";
+                const uint64_t target = stats.outputTarget;
+                if (phase == SortPhase::FinalMerge && target > 0) {
+                    line += " из " + std::to_string(target >> 20) + " МиБ (" +
+                            std::to_string(std::min<uint64_t>(stats.writtenInPhase() * 100 / target, 100)) + "%)";
+                }
+            }
+            line += "; чтение " + std::to_string(mebibytesPerSecond(read - lastRead, nanos)) + " МиБ/с, запись " +
+                    std::to_string(mebibytesPerSecond(written - lastWritten, nanos)) + " МиБ/с\n";
+            std::cerr << line << std::flush;
+
+            last = now;
+            lastRead = read;
+            lastWritten = written;
+        }
+    }
+
+public:
+    // interval = 0 отключает вывод
+    ProgressReporter(const SortStats& stats, std::chrono::seconds interval) : stats(stats), interval(interval) {
+        if (interval.count() > 0) {
+            thread = std::thread(&ProgressReporter::run, this);
+        }
+    }
+
+    ~ProgressReporter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        stopped.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+};
+
+// Выводит статистику в текстовом виде
+inline void printStats(std::ostream& out, const SortStats& stats, uint64_t bytesRead, uint64_t bytesWritten) {
+    auto ms = [](const std::atomic<uint64_t>& nanos) {
+        return nanos.load() / 1000000;
+    };
+    out << "Статистика:" << std::endl;
+    if (stats.inMemory) {
+        out << "  вход отсортирован в памяти, временные серии не создавались" << std::endl;
+    }
+    out << "  разбор входа: " << ms(stats.parseNanos) << " мс, "
+        << mebibytesPerSecond(stats.inputBytes, stats.parseNanos) << " МиБ/с" << std::endl;
+    out << "  сортировка пакетов: " << ms(stats.sortNanos) << " мс, пакетов: " << stats.batchesSorted << std::endl;
+    out << "  запись серий: " << ms(stats.runWriteNanos) << " мс, "
+        << mebibytesPerSecond(stats.runBytes, stats.runWriteNanos) << " МиБ/с" << std::endl;
+    out << "  формирование серий (всего): " << ms(stats.runGenerationNanos) << " мс" << std::endl;
+    out << "  промежуточные слияния: " << ms(stats.intermediateMergeNanos) << " мс, "
+        << mebibytesPerSecond(stats.intermediateBytes, stats.intermediateMergeNanos) << " МиБ/с" << std::endl;
+    out << "  последнее слияние и запись результата: " << ms(stats.finalMergeNanos) << " мс, "
+        << mebibytesPerSecond(stats.outputBytes, stats.finalMergeNanos) << " МиБ/с" << std::endl;
+    out << "  строк: " << stats.linesParsed << ", пропущено некорректных: " << stats.malformedLines << std::endl;
+    out << "  серий: " << stats.runs << ", промежуточных: " << stats.intermediateRuns
+        << ", проходов слияния: " << stats.mergePasses << std::endl;
+    out << "  байт входа: " << stats.inputBytes << std::endl;
+    out << "  прочитано с диска байт: " << bytesRead << std::endl;
+    out << "  записано на диск байт: " << bytesWritten << std::endl;
+    const uint64_t peak = peakMemoryBytes();
+    if (peak > 0) {
+        out << "  пиковая память: " << peak / (1024 * 1024) << " МиБ" << std::endl;
+    } else {
+        out << "  пиковая память: недоступно" << std::endl;
+    }
+}
+
+// Выводит статистику одной строкой JSON для обработки скриптами
+// Время - в миллисекундах, скорости - в МиБ/с, пиковая память 0 - недоступно
+inline void printStatsJson(std::ostream& out, const SortStats& stats, uint64_t bytesRead, uint64_t bytesWritten,
+                           uint64_t wallMillis) {
+    auto phase = [](const char* name, const std::atomic<uint64_t>& nanos, const std::atomic<uint64_t>& bytes) {
+        return std::string("\"") + name + "\":{\"ms\":" + std::to_string(nanos.load() / 1000000) +
+               ",\"bytes\":" + std::to_string(bytes.load()) +
+               ",\"mib_per_s\":" + std::to_string(mebibytesPerSecond(bytes, nanos)) + "}";
+    };
+    out << "{\"wall_ms\":" << wallMillis
+        << ",\"threads\":" << stats.threads
+        << ",\"memory_limit\":" << stats.memoryLimit
+        << ",\"batch_budget\":" << stats.batchBudget
+        << ",\"fan_in\":" << stats.fanIn
+        << ",\"in_memory\":" << (stats.inMemory ? "true" : "false")
+        << ",\"input_bytes\":" << stats.inputBytes
+        << ",\"lines_parsed\":" << stats.linesParsed
+        << ",\"malformed_lines\":" << stats.malformedLines
+        << ",\"batches_sorted\":" << stats.batchesSorted
+        << ",\"runs\":" << stats.runs
+        << ",\"intermediate_runs\":" << stats.intermediateRuns
+        << ",\"merge_passes\":" << stats.mergePasses
+        << ",\"bytes_read\":" << bytesRead
+        << ",\"bytes_written\":" << bytesWritten
+        << ",\"peak_rss_bytes\":" << peakMemoryBytes()
+        << ",\"phases\":{" << phase("parse", stats.parseNanos, stats.inputBytes)
+        << ",\"sort\":{\"ms\":" << stats.sortNanos / 1000000 << ",\"batches\":" << stats.batchesSorted << "}"
+        << "," << phase("run_write", stats.runWriteNanos, stats.runBytes)
+        << ",\"run_generation\":{\"ms\":" << stats.runGenerationNanos / 1000000 << "}"
+        << "," << phase("intermediate_merge", stats.intermediateMergeNanos, stats.intermediateBytes)
+        << "," << phase("final_merge", stats.finalMergeNanos, stats.outputBytes)
+        << "}}" << std::endl;
+}
+
+#endif // SORT_STATS_H
@@ -0,0 +1,111 @@
+#ifndef TEXT_SCAN_H
+#define TEXT_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Разбор входного текста по строкам "key:value"
+// Поиск разделителей идет векторно по 32 (AVX2) или 16 (SSE2) байт за сравнение,
+// а десятичный ключ переводится в число по 8 цифр за раз (SWAR). Набор инструкций
+// выбирается при компиляции (-march=native), без них используется скалярный код
+
+// Ищет первый байт, равный first или second, в [begin, end); возвращает end, если его нет
+inline const char* findFirstOf(const char* begin, const char* end, char first, char second) {
+    const char* cursor = begin;
+#if defined(__AVX2__)
+    const __m256i firstMask = _mm256_set1_epi8(first);
+    const __m256i secondMask = _mm256_set1_epi8(second);
+    for (; end - cursor >= 32; cursor += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+        const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, firstMask), _mm256_cmpeq_epi8(chunk, secondMask));
+        const uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (bits != 0) {
+            return cursor + __builtin_ctz(bits);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i firstMask16 = _mm_set1_epi8(first);
+    const __m128i secondMask16 = _mm_set1_epi8(second);
+    for (; end - cursor >= 16; cursor += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+        const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, firstMask16), _mm_cmpeq_epi8(chunk, secondMask16));
+        const uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (bits != 0) {
+            return cursor + __builtin_ctz(bits);
+        }
+    }
+#endif
+    for (; cursor != end; ++cursor) {
+        if (*cursor == first || *cursor == second) {
+            return cursor;
+        }
+    }
+    return end;
+}
+
+// Ищет байт value в [begin, end); возвращает end, если его нет
+inline const char* findByte(const char* begin, const char* end, char value) {
+    return findFirstOf(begin, end, value, value);
+}
+
+// Переводит 8 десятичных цифр (по байту на цифру, первая - младший байт) в число
+// Возвращает false, если среди байтов есть не цифра
+inline bool parseEightDigits(uint64_t chunk, uint32_t& value) {
+    const uint64_t digits = chunk - 0x3030303030303030ULL;
+    // Байт - цифра, если он не меньше '0' и после прибавления 0x46 не выходит за 0x7F
+    if (((chunk + 0x4646464646464646ULL) | digits) & 0x8080808080808080ULL) {
+        return false;
+    }
+    // Попарно складываем соседние цифры, затем пары и четверки
+    uint64_t folded = digits * 10 + (digits >> 8);
+    folded = (((folded & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+              (((folded >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    value = static_cast<uint32_t>(folded);
+    return true;
+}
+
+// Разбирает десятичный ключ в начале [begin, end) так же, как std::from_chars:
+// читаются ведущие цифры до первой не цифры, пустое число и переполнение uint64 - ошибка
+inline bool parseKey(const char* begin, const char* end, uint64_t& key) {
+    const char* cursor = begin;
+    while (cursor != end && *cursor == '0') {
+        ++cursor; // ведущие нули не влияют на значение и на переполнение
+    }
+
+    uint64_t value = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Без ведущих нулей в uint64 помещается не более 20 цифр, поэтому блоками
+    // по 8 разбираем не больше 16, а остаток - скалярно с проверкой переполнения
+    for (int chunks = 0; chunks < 2 && end - cursor >= 8; ++chunks) {
+        uint64_t chunk;
+        std::memcpy(&chunk, cursor, sizeof(chunk));
+        uint32_t eight;
+        if (!parseEightDigits(chunk, eight)) {
+            break;
+        }
+        value = value * 100000000ULL + eight;
+        cursor += 8;
+    }
+#endif
+    for (; cursor != end && static_cast<unsigned char>(*cursor - '0') <= 9; ++cursor) {
+        const uint64_t digit = static_cast<uint64_t>(*cursor - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+
+    if (cursor == begin) {
+        return false; // ни одной цифры
+    }
+    key = value;
+    return true;
+}
+
+#endif // TEXT_SCAN_H